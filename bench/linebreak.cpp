@@ -0,0 +1,148 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "LineBreak.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace GL;
+
+namespace {
+  // Every character is 8 units wide, with a little kerning between letters so the kerning path isn't skipped
+  void FixedMeasure(void* context, char32_t prev, char32_t cur, float& advance, float& kerning)
+  {
+    ++*static_cast<size_t*>(context);
+    advance = (cur == ' ') ? 4.0f : 8.0f;
+    kerning = (prev == 'A' && cur == 'V') ? -1.0f : 0.0f;
+  }
+
+  // Paragraphs of pseudo-random words, with the odd long word, hyphen and punctuation mixed in
+  std::u32string Generate(size_t len)
+  {
+    const char32_t* words[] = { U"the",   U"quick",   U"brown",      U"fox",     U"jumps",
+                                U"over",  U"lazy",    U"dog,",       U"AVA",     U"well-known",
+                                U"(maybe)", U"3.14159", U"\u00E9t\u00E9", U"\u4F60\u597D\u4E16\u754C",
+                                U"antidisestablishmentarianism" };
+    const size_t count = sizeof(words) / sizeof(words[0]);
+    std::u32string text;
+    text.reserve(len + 64);
+    uint32_t seed = 12345;
+    size_t n      = 0;
+    while(text.size() < len)
+    {
+      seed = seed * 1664525 + 1013904223;
+      text += words[(seed >> 16) % count];
+      text += (++n % 200 == 0) ? U'\n' : U' ';
+    }
+    return text;
+  }
+
+  void Run(const std::u32string& text, float maxwidth, FG_BreakStyle style, const char* name)
+  {
+    size_t measured = 0;
+    size_t lines    = 0;
+    auto start      = std::chrono::steady_clock::now();
+
+    LineBreaker breaker(text.data(), text.size(), 0, maxwidth, 0.0f, style, &FixedMeasure, &measured);
+    size_t offset = 0;
+    do
+    {
+      ++lines;
+      offset = breaker.Next(offset);
+    } while(offset < text.size());
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double mb = (text.size() * sizeof(char32_t)) / (1024.0 * 1024.0);
+    printf("%-12s %8.2f MB %10zu lines %10zu measured %10.2f ms %10.2f MB/s\n", name, mb, lines, measured,
+           elapsed.count() * 1000.0, mb / elapsed.count());
+  }
+
+  // Every character is one unit wide, so maxwidth is a column count
+  void UnitMeasure(void* context, char32_t prev, char32_t cur, float& advance, float& kerning)
+  {
+    advance = 1.0f;
+    kerning = 0.0f;
+  }
+
+  struct BreakCase
+  {
+    const char* name;
+    const char32_t* text;
+    float maxwidth;
+    FG_BreakStyle style;
+    const char32_t* expected; // The text with a | inserted where each new line starts
+  };
+
+  // clang-format off
+  const BreakCase CASES[] = {
+    { "no wrap",           U"hello world",              3.0f,  FG_BreakStyle_NONE,      U"hello world" },
+    { "LF",                U"ab\ncd",                   -1.0f, FG_BreakStyle_WORD,      U"ab\n|cd" },
+    { "CR LF",             U"ab\r\ncd",                 -1.0f, FG_BreakStyle_WORD,      U"ab\r\n|cd" },
+    { "character",         U"abcdef",                   4.0f,  FG_BreakStyle_CHARACTER, U"abcd|ef" },
+    { "long word",         U"abcdefgh",                 3.0f,  FG_BreakStyle_WORD,      U"abc|def|gh" },
+    { "LB18 after space",  U"hello world",              8.0f,  FG_BreakStyle_WORD,      U"hello |world" },
+    { "LB7 hanging space", U"hello   world",            5.0f,  FG_BreakStyle_WORD,      U"hello   |world" },
+    { "LB8 after ZW",      U"abc\u200Bdef",             4.0f,  FG_BreakStyle_WORD,      U"abc\u200B|def" },
+    { "LB9 mark after OP", U"ab (\u0301cd",             5.0f,  FG_BreakStyle_WORD,      U"ab |(\u0301cd" },
+    { "LB12 after GL",     U"ab c\u00A0de",             5.0f,  FG_BreakStyle_WORD,      U"ab |c\u00A0de" },
+    { "LB13 before EX",    U"ab cd!",                   5.0f,  FG_BreakStyle_WORD,      U"ab |cd!" },
+    { "LB14 OP SP",        U"ab ( cd",                  5.0f,  FG_BreakStyle_WORD,      U"ab |( cd" },
+    { "LB18 before HY",    U"ab -cd",                   3.0f,  FG_BreakStyle_WORD,      U"ab |-cd" },
+    { "LB21 after HY",     U"well-known",               7.0f,  FG_BreakStyle_WORD,      U"well-|known" },
+    { "LB25 HY NU",        U"ab -42",                   4.0f,  FG_BreakStyle_WORD,      U"ab |-42" },
+    { "LB25 NU IS NU",     U"x 3.14159",                7.0f,  FG_BreakStyle_WORD,      U"x |3.14159" },
+    { "LB30 AL OP",        U"ab f(x)",                  4.0f,  FG_BreakStyle_WORD,      U"ab |f(x)" },
+    { "LB31 ID",           U"\u4F60\u597D\u4E16\u754C", 2.0f,  FG_BreakStyle_WORD,      U"\u4F60\u597D|\u4E16\u754C" },
+  };
+  // clang-format on
+
+  // Breaks every case with UnitMeasure and compares the line starts against the expected ones
+  int Check()
+  {
+    int failures = 0;
+    for(auto& c : CASES)
+    {
+      std::u32string text(c.text);
+      std::u32string result;
+      LineBreaker breaker(text.data(), text.size(), 0, c.maxwidth, 0.0f, c.style, &UnitMeasure, nullptr);
+      size_t offset = 0;
+      do
+      {
+        size_t next = breaker.Next(offset);
+        if(!result.empty())
+          result += U'|';
+        result.append(text, offset, next - offset);
+        if(next <= offset)
+          break;
+        offset = next;
+      } while(offset < text.size());
+
+      if(result != c.expected)
+      {
+        printf("FAILED %s\n", c.name);
+        ++failures;
+      }
+    }
+
+    printf("%s\n", failures ? "Line break check failed" : "Line break check passed");
+    return failures ? 1 : 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 1 && !strcmp(argv[1], "check"))
+    return Check();
+
+  size_t len = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (4 << 20);
+  auto text  = Generate(len);
+
+  Run(text, -1.0f, FG_BreakStyle_NONE, "none");
+  Run(text, 400.0f, FG_BreakStyle_CHARACTER, "character");
+  Run(text, 400.0f, FG_BreakStyle_WORD, "word");
+  Run(text, 60.0f, FG_BreakStyle_WORD, "word-narrow");
+  return 0;
+}
@@ -0,0 +1,183 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "utf.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+  // Repeats the sample until the text is len bytes long, cutting it at a code point boundary
+  std::string Generate(const char* sample, size_t len)
+  {
+    std::string text;
+    text.reserve(len + 64);
+    while(text.size() < len)
+      text += sample;
+    while(text.size() > len && (text[len] & 0xC0) == 0x80)
+      ++len;
+    text.resize(len);
+    return text;
+  }
+
+  void Run(const char* name, const std::string& text)
+  {
+    const int REPEAT = 8;
+    std::vector<char32_t> out(text.size() + 1);
+    size_t decoded = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < REPEAT; ++i)
+      decoded = UTF8toUTF32(text.data(), text.size(), nullptr, 0);
+    std::chrono::duration<double> counting = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < REPEAT; ++i)
+      decoded = UTF8toUTF32(text.data(), text.size(), out.data(), out.size());
+    std::chrono::duration<double> decoding = std::chrono::steady_clock::now() - start;
+
+    double mb = (text.size() * REPEAT) / (1024.0 * 1024.0);
+    printf("%-8s %8.2f MB %10zu code points   count %10.2f MB/s   decode %10.2f MB/s\n", name, mb / REPEAT, decoded,
+           mb / counting.count(), mb / decoding.count());
+  }
+
+  // Plain byte-at-a-time decoder with the same contract as UTF8toUTF32: the sizing pass counts lead bytes up to the
+  // terminator plus one, and decoding includes the terminator if it's within srclen but stops at the first invalid or
+  // truncated sequence.
+  size_t Reference(const char* input, ptrdiff_t srclen, char32_t* output, size_t buflen)
+  {
+    if(!srclen)
+      return 0;
+    size_t end   = 0;
+    size_t count = 1;
+    for(; (srclen < 0 || ptrdiff_t(end) < srclen) && input[end]; ++end)
+      count += (input[end] & 0xC0) != 0x80;
+    if(!output)
+      return count;
+    if(srclen < 0 || ptrdiff_t(end) < srclen)
+      ++end;
+
+    auto s   = reinterpret_cast<const uint8_t*>(input);
+    size_t n = 0;
+    for(size_t i = 0; i < end && n < buflen;)
+    {
+      uint8_t c = s[i];
+      int extra = c < 0x80 ? 0 : c < 0xC2 ? -1 : c < 0xE0 ? 1 : c < 0xF0 ? 2 : c < 0xF5 ? 3 : -1;
+      if(extra < 0 || size_t(extra) >= end - i)
+        break;
+
+      char32_t ch = extra ? (c & (0x3F >> extra)) : c;
+      bool legal  = true;
+      for(int k = 1; k <= extra; ++k)
+      {
+        legal = legal && (s[i + k] & 0xC0) == 0x80;
+        ch    = (ch << 6) | (s[i + k] & 0x3F);
+      }
+      // Overlong encodings, surrogates and anything past U+10FFFF
+      if(!legal || (c == 0xE0 && s[i + 1] < 0xA0) || (c == 0xED && s[i + 1] > 0x9F) || (c == 0xF0 && s[i + 1] < 0x90) ||
+         (c == 0xF4 && s[i + 1] > 0x8F))
+        break;
+
+      output[n++] = ch;
+      i += extra + 1;
+    }
+    return n;
+  }
+
+  int failures = 0;
+
+  void Expect(const char* name, const std::string& text, ptrdiff_t srclen, const std::u32string& decoded, size_t count)
+  {
+    std::vector<char32_t> out(text.size() + 2, 0xDEADBEEF);
+    size_t sized = UTF8toUTF32(text.c_str(), srclen, nullptr, 0);
+    size_t n     = UTF8toUTF32(text.c_str(), srclen, out.data(), out.size());
+    if(sized != count || n != decoded.size() || memcmp(out.data(), decoded.data(), n * sizeof(char32_t)) != 0)
+    {
+      printf("FAILED %s: counted %zu (expected %zu), decoded %zu (expected %zu)\n", name, sized, count, n,
+             decoded.size());
+      ++failures;
+    }
+  }
+
+  // Checks fixed cases with known answers, then random mixes of valid and invalid sequences against Reference, with
+  // text long enough to cross the vector width at every alignment and output buffers of every size.
+  int Check()
+  {
+    const std::string run(37, 'x'); // Puts the interesting bytes after a vector's worth of ASCII
+    using namespace std::string_literals;
+
+    Expect("empty", "", 0, U"", 0);
+    Expect("ascii", "abc", 3, U"abc", 4);
+    Expect("ascii terminated", "abc", -1, U"abc\0"s, 4);
+    Expect("embedded null", "ab\0cd"s, 5, U"ab\0"s, 3);
+    Expect("embedded null in run", run + "\0yy"s, run.size() + 3, std::u32string(run.begin(), run.end()) + U'\0', 38);
+    Expect("two bytes", "\xC3\xA9", -1, U"é\0"s, 2);
+    Expect("three bytes", "\xE4\xBD\xA0", -1, U"你\0"s, 2);
+    Expect("four bytes", "\xF0\x9F\x98\x80", -1, U"\U0001F600\0"s, 2);
+    Expect("truncated tail", "a\xE4\xBD", 3, U"a", 3);
+    Expect("truncated tail in run", run + "\xF0\x9F\x98", run.size() + 3, std::u32string(run.begin(), run.end()), 39);
+    Expect("cut by srclen", "\xC3\xA9z", 1, U"", 2);
+    Expect("overlong", "\xC0\xAF", -1, U"", 2);
+    Expect("overlong three bytes", "\xE0\x80\xAF", -1, U"", 2);
+    Expect("surrogate", "\xED\xA0\x80", -1, U"", 2);
+    Expect("past U+10FFFF", "\xF4\x90\x80\x80", -1, U"", 2);
+    Expect("invalid lead", "\xF5\x80\x80\x80", -1, U"", 2);
+    Expect("stray continuation", "a\x80z", -1, U"a", 3);
+    Expect("invalid in run", run + "\xFFzz", -1, std::u32string(run.begin(), run.end()), 41);
+
+    const char* pieces[] = { "a",    "hello ",       "\xC3\xA9", "\xE4\xBD\xA0", "\xF0\x9F\x98\x80", "\xED\xA0\x80",
+                             "\xC0\xAF", "\x80", "\xFF", "0123456789abcdefghijklmnopqrstuvwxyz" };
+    const int weights[]  = { 10, 10, 10, 10, 5, 1, 1, 1, 1, 51 };
+    srand(1);
+    for(int i = 0; i < 100000 && failures < 10; ++i)
+    {
+      std::string text;
+      for(int n = rand() % 24; n > 0; --n)
+      {
+        int pick = rand() % 100;
+        int k    = 0;
+        while(pick >= weights[k])
+          pick -= weights[k++];
+        text += (rand() % 50) ? pieces[k] : "\0"s;
+      }
+
+      ptrdiff_t srclen = (rand() % 3) ? -1 : ptrdiff_t(rand() % (text.size() + 1));
+      size_t buflen    = (rand() % 2) ? text.size() + 1 : size_t(rand() % (text.size() + 2));
+      std::vector<char32_t> a(buflen + 40, 0xDEADBEEF);
+      std::vector<char32_t> b(buflen + 1, 0xDEADBEEF); // Never empty, so a zero buflen is not a sizing pass
+
+      size_t counted  = UTF8toUTF32(text.c_str(), srclen, nullptr, 0);
+      size_t expected = Reference(text.c_str(), srclen, nullptr, 0);
+      size_t n        = UTF8toUTF32(text.c_str(), srclen, a.data(), buflen);
+      size_t m        = Reference(text.c_str(), srclen, b.data(), buflen);
+      // The vector paths may leave scratch values past the decoded count, but never past buflen
+      bool overrun = std::any_of(a.begin() + buflen, a.end(), [](char32_t c) { return c != 0xDEADBEEF; });
+      if(counted != expected || n != m || overrun || memcmp(a.data(), b.data(), n * sizeof(char32_t)) != 0)
+      {
+        printf("FAILED random case %i: %zu bytes, srclen %td, buflen %zu\n", i, text.size(), srclen, buflen);
+        ++failures;
+      }
+    }
+
+    printf("%s\n", failures ? "UTF-8 check failed" : "UTF-8 check passed");
+    return failures ? 1 : 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 1 && !strcmp(argv[1], "check"))
+    return Check();
+
+  size_t len = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (16 << 20);
+
+  Run("ascii", Generate("[12:00:01] INFO Loaded 42 assets from ./data/ui in 3.5ms\n", len));
+  Run("latin", Generate("Größenänderung des Fensters ist fehlgeschlagen, versuchen Sie es später erneut. ", len));
+  Run("cjk", Generate("ウィンドウのサイズを変更できませんでした。後でもう一度お試しください。", len));
+  Run("mixed", Generate("Error: 文件 \"données.txt\" not found (код 404) 😀\n", len));
+  return 0;
+}
@@ -3,7 +3,12 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <math.h>
+#include <string.h>
 #include <time.h>
+#ifdef _WIN32
+  #include <windows.h>
+#endif
+#include <GL/gl.h>
 
 #define BACKEND fgOpenGL
 #define TEST(x)                      \
@@ -37,6 +42,7 @@ struct MockElement : FG_MsgReceiver
   FG_Shader* shader;
   FG_Asset* vertices;
   FG_Asset* layer;
+  FG_Asset* cached;
   void* layout;
   uint64_t flags;
   bool close;
@@ -44,6 +50,38 @@ struct MockElement : FG_MsgReceiver
 
 static FG_Command FAKE_CMD;
 
+// Reads a pixel of whatever is being drawn to, with y measured from the top like every other feather coordinate
+static uint32_t ReadPixel(int x, int y)
+{
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  uint8_t px[4];
+  glReadPixels(x, viewport[3] - 1 - y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, px);
+  return px[0] | (px[1] << 8) | (px[2] << 16) | (uint32_t(px[3]) << 24);
+}
+
+// Redraws a dirty rect near the top of a cached layer. Only that rect may change, and in particular not the rect
+// mirrored around the middle of the layer, which is where it lands if the scissor box isn't flipped.
+static void TestLayerDamage(FG_Backend* b, FG_Window* w, FG_Asset* layer)
+{
+  float transform[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+  TEST(FG_PushLayer(b, w, layer, transform, 0.0f, nullptr) == 0);
+  FG_Clear(b, w, FG_Color{ 0xFF000000 });
+  FG_PopLayer(b, w);
+
+  auto top = FG_Rect{ 8.f, 4.f, 24.f, 12.f };
+  TEST(FG_InvalidateLayer(b, w, layer, &top) == 0);
+  TEST(FG_PushLayer(b, w, layer, transform, 0.0f, nullptr) == 0);
+  FG_Clear(b, w, FG_Color{ 0xFFFFFFFF });
+  TEST(ReadPixel(16, 8) == 0xFFFFFFFF);
+  TEST(ReadPixel(16, 55) == 0xFF000000);
+  TEST(ReadPixel(16, 20) == 0xFF000000);
+  FG_PopLayer(b, w);
+
+  TEST(FG_PushLayer(b, w, layer, transform, 0.0f, nullptr) == 1); // Nothing was invalidated, so the layer is CACHED
+  FG_PopLayer(b, w);
+}
+
 void SetShape(decltype(FAKE_CMD.shape)& shape, FG_Rect& area, float border, FG_Color fill, FG_Color outline, float blur)
 {
   shape.area        = &area;
@@ -64,6 +102,21 @@ FG_Result behavior(FG_MsgReceiver* element, FG_Window* w, void* ui, FG_Msg* m)
   {
     ++counter;
     FG_Backend* b = *(FG_Backend**)ui;
+
+    // Damage is redrawn through the scissor box, which counts rows from the bottom and so has to be flipped
+    if(glIsEnabled(GL_SCISSOR_TEST))
+    {
+      GLint box[4];
+      GLint viewport[4];
+      glGetIntegerv(GL_SCISSOR_BOX, box);
+      glGetIntegerv(GL_VIEWPORT, viewport);
+      TEST(box[1] == viewport[3] - static_cast<GLint>(ceilf(m->draw.area.bottom)));
+      TEST(box[3] == static_cast<GLint>(ceilf(m->draw.area.bottom) - floorf(m->draw.area.top)));
+    }
+
+    if(counter == 1)
+      TestLayerDamage(b, w, e.cached);
+
     FG_Clear(b, w, FG_Color{ 0xFF000000 });
 
     // Here we batch 8 different draw calls all at once. We do not know if the backend is actually capable of drawing
@@ -192,6 +245,75 @@ FG_Result behavior(FG_MsgReceiver* element, FG_Window* w, void* ui, FG_Msg* m)
   return FG_Result{ -1 };
 }
 
+// Writes text with count characters at offset replaced by insert
+static void Splice(char* out, const char* text, size_t offset, size_t count, const char* insert)
+{
+  memcpy(out, text, offset);
+  strcpy(out + offset, insert);
+  strcat(out, text + offset + count);
+}
+
+// A layout built incrementally from the previous layout of the text must be indistinguishable from a fresh one. The
+// test text is ASCII, so every byte is a character. Every character's position is compared, which catches any line
+// that starts somewhere else, and then hit-testing is compared over a grid covering every line.
+static void TestIncrementalLayout(FG_Backend* b, FG_Font* font)
+{
+  const char* base = "The quick brown fox jumps over the lazy dog.\nPack my box with five dozen liquor jugs, "
+                     "then sphinx of black quartz, judge my vow.";
+  struct Edit
+  {
+    size_t offset;
+    size_t count;
+    const char* insert;
+  };
+  const size_t len   = strlen(base);
+  const Edit edits[] = {
+    { 0, 0, "Sometimes " },    { len / 2, 0, "extraordinarily " }, { len, 0, " The end." },
+    { 0, 4, "" },              { len / 2, 7, "" },                 { len - 5, 5, "" },
+    { 0, 0, "\n" },            { len / 2, 0, "\n" },               { len, 0, "\n" },
+    { 44, 1, " " },            { 20, 1, "\n\n" },                  { 0, len, "" },
+  };
+  const float lineheight = 16.f;
+  FG_Rect area           = { 0.f, 0.f, 150.f, 1000.f };
+  char edited[512];
+
+  for(auto& edit : edits)
+  {
+    Splice(edited, base, edit.offset, edit.count, edit.insert);
+    void* prev  = FG_FontLayout(b, font, base, &area, lineheight, 0.f, FG_BreakStyle_WORD, nullptr);
+    void* inc   = FG_FontLayout(b, font, edited, &area, lineheight, 0.f, FG_BreakStyle_WORD, prev);
+    void* fresh = FG_FontLayout(b, font, edited, &area, lineheight, 0.f, FG_BreakStyle_WORD, nullptr);
+    TEST(inc != nullptr && fresh != nullptr);
+    if(!inc || !fresh)
+      continue;
+
+    bool same    = true;
+    float bottom = 0.f;
+    for(uint32_t i = 0; i <= strlen(edited); ++i)
+    {
+      FG_Vec a = FG_FontPos(b, font, inc, &area, i);
+      FG_Vec f = FG_FontPos(b, font, fresh, &area, i);
+      same     = same && a.x == f.x && a.y == f.y;
+      bottom   = fmaxf(bottom, f.y + lineheight);
+    }
+    TEST(same);
+
+    same = true;
+    for(float y = 1.f; y < bottom; y += lineheight / 2)
+      for(float x = -5.f; x < area.right + 5.f; x += 3.f)
+      {
+        FG_Vec a, f;
+        same = same && FG_FontIndex(b, font, inc, &area, FG_Vec{ x, y }, &a) ==
+                         FG_FontIndex(b, font, fresh, &area, FG_Vec{ x, y }, &f) &&
+               a.x == f.x && a.y == f.y;
+      }
+    TEST(same);
+
+    FG_DestroyLayout(b, inc);
+    FG_DestroyLayout(b, fresh);
+  }
+}
+
 int main(int argc, char* argv[])
 {
   FG_Backend* ui;
@@ -251,6 +373,7 @@ int main(int argc, char* argv[])
   e.image    = FG_CreateAsset(b, (const char*)EXAMPLE_PNG_ARRAY, sizeof(EXAMPLE_PNG_ARRAY), FG_Format_PNG, 0);
   e.font     = FG_CreateFont(b, "Arial", 700, false, 16, FG_Vec{ 96.f, 96.f }, FG_AntiAliasing_AA);
   e.layout   = FG_FontLayout(b, e.font, "Example Text!", &textrect, 16.f, 0.f, FG_BreakStyle_NONE, nullptr);
+  TestIncrementalLayout(b, e.font);
   e.shader   = FG_CreateShader(b, shader_fs, shader_vs, 0, 0, 0, 0, params, 2);
   e.vertices = FG_CreateBuffer(b, verts, sizeof(verts), FG_Primitive_TRIANGLE_STRIP, vertparams, 2);
   e.close    = false;
@@ -268,6 +391,8 @@ int main(int argc, char* argv[])
 
   FG_Vec layerdim = { 200, 100 };
   e.layer         = FG_CreateLayer(b, w, &layerdim, 0);
+  FG_Vec cachedim = { 64, 64 };
+  e.cached        = FG_CreateLayer(b, w, &cachedim, FG_AssetFlags_CACHE_LAYER);
 
   TEST(FG_SetCursor(b, w, FG_Cursor_CROSS) == 0);
   TEST(FG_DirtyRect(b, w, 0) == 0);
@@ -299,12 +424,18 @@ int main(int argc, char* argv[])
 
   TEST(FG_GetClipboard(b, w, FG_Clipboard_WAVE, hold, 10) == 0)
 
+  // Redraw a strip that isn't vertically centered, so an unflipped scissor box would redraw the wrong part
+  auto strip = FG_Rect{ 10.f, 10.f, 300.f, 50.f };
+  TEST(FG_DirtyRect(b, w, &strip) == 0);
+  TEST(FG_ProcessMessages(b) != 0);
+
   while(FG_ProcessMessages(b) != 0 && e.close == false)
   {
     FG_DirtyRect(b, w, 0);
   }
 
   TEST(FG_DestroyAsset(b, e.layer) == 0); // Must destroy layers before destroying the window
+  TEST(FG_DestroyAsset(b, e.cached) == 0);
   TEST(FG_DestroyWindow(b, w) == 0);
   TEST(FG_DestroyAsset(b, e.image) == 0);
   TEST(FG_DestroyLayout(b, e.layout) == 0);
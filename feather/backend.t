@@ -382,11 +382,21 @@ struct B.Backend {
   tooltipdelay : uint64
 }
 
+-- Remember the order methods are declared in, because pairs() over B.Backend.methods has no stable order and the
+-- generated function pointer fields, their typedefs and the C header would otherwise shuffle between builds.
+local declared = {}
+setmetatable(B.Backend.methods, { __newindex = function(t, k, v) table.insert(declared, k); rawset(t, k, v) end })
+
 -- Define a dynamic backend object (a static backend would be a seperate type that also provides these functions).
 terra B.Backend:Draw(window : &Msg.Window, commands : &B.Command, n_commands : uint, blendstate : &B.BlendState) : F.Err return 0 end
 terra B.Backend:Clear(window : &Msg.Window, color : F.Color) : bool return false end -- Clears whatever is inside the current clipping rect
+-- Returns 0 if the layer has to be drawn, or a negative error. Returns 1, which is not an error, if the layer was created
+-- with CACHE_LAYER and nothing in it was invalidated, in which case the caller can skip straight to PopLayer. If only part of
+-- a cached layer was invalidated, this returns 0 and everything drawn is clipped to the invalidated area.
 terra B.Backend:PushLayer(window : &Msg.Window, layer : &B.Asset, transform : &float, opacity : float, blendstate : &B.BlendState) : F.Err return 0 end
 terra B.Backend:PopLayer(window : &Msg.Window) : F.Err return 0 end
+-- Forces part of a cached layer to be redrawn the next time it is pushed, or all of it if area is nil.
+terra B.Backend:InvalidateLayer(window : &Msg.Window, layer : &B.Asset, area : &F.Rect) : F.Err return 0 end
 terra B.Backend:SetRenderTarget(window : &Msg.Window, target : &B.Asset) : F.Err return 0 end
 terra B.Backend:PushClip(window : &Msg.Window, area : &F.Rect) : F.Err return 0 end
 terra B.Backend:PopClip(window : &Msg.Window) : F.Err return 0 end
@@ -403,6 +413,10 @@ terra B.Backend:FontLayout(font : &B.Font, text : F.conststring, area : &F.Rect,
 terra B.Backend:DestroyLayout(layout : &opaque) : F.Err return 0 end
 terra B.Backend:FontIndex(font : &B.Font, layout : &opaque, area : &F.Rect, pos : F.Vec, cursor : &F.Vec) : uint return 0 end
 terra B.Backend:FontPos(font : &B.Font, layout : &opaque, area :&F.Rect, index : uint) : F.Vec return F.Vec{} end
+-- Rasterizes the glyphs in text (which can be nil) and every codepoint in [first, last) ahead of time, in the background if possible, so drawing them later doesn't stall.
+terra B.Backend:PrewarmFont(font : &B.Font, text : F.conststring, first : uint, last : uint) : F.Err return 0 end
+-- Sets the fonts searched, in order, for characters font doesn't have. Fallbacks must outlive any layout made with font.
+terra B.Backend:SetFontFallback(font : &B.Font, fallbacks : &&B.Font, count : uint) : F.Err return 0 end
 
 terra B.Backend:CreateAsset(data : F.conststring, count : uint, format : B.Format, flags : int) : &B.Asset return nil end
 terra B.Backend:CreateBuffer(data : &opaque, bytes : uint, primitive : B.Primitive, parameters : &B.ShaderParameter, n_parameters : uint) : &B.Asset return nil end
@@ -424,6 +438,10 @@ terra B.Backend:DestroySystemControl(window : &Msg.Window, control : &opaque) :
 
 terra B.Backend:GetSyncObject() : &opaque return nil end
 terra B.Backend:ProcessMessages() : F.Err return 0 end
+-- Like ProcessMessages, but blocks until input arrives, a window is due for a frame, timeout seconds have passed, or Wake is called. A negative timeout waits forever.
+terra B.Backend:WaitMessages(timeout : double) : F.Err return 0 end
+-- Wakes up a blocked WaitMessages call. Can be called from any thread.
+terra B.Backend:Wake() : F.Err return 0 end
 terra B.Backend:SetCursor(window : &Msg.Window, cursor : B.Cursor) : F.Err return 0 end
 terra B.Backend:GetDisplayIndex(index : uint, out : &B.Display) : F.Err return 0 end
 terra B.Backend:GetDisplay(handle : &opaque, out : &B.Display) : F.Err return 0 end
@@ -436,7 +454,9 @@ terra B.Backend:DestroyWindow(window : &Msg.Window) : F.Err return 0 end
 -- Generate both the function pointer field and redefine the function to call the generated function pointer
 do
   local map = {}
-  for k, v in pairs(B.Backend.methods) do
+  setmetatable(B.Backend.methods, nil)
+  for i, k in ipairs(declared) do
+    local v = B.Backend.methods[k]
     klow = string.lower(k:sub(1,1)) .. k:sub(2, -1)
     v.c_body = "return (*self->"..klow..")("
 
@@ -453,7 +473,7 @@ do
     B[k] = v
     B.Backend.entries:insert({field = klow, type = terralib.types.pointer(v:gettype())})
     
-    map[klow] = v -- TODO: alphabetically sort map before putting in entries, or use a C struct sorting method on the resulting struct
+    map[klow] = v
   end
 
   for k, v in pairs(map) do
@@ -7,7 +7,7 @@ local map_pairs = require 'feather.util'.map_pairs
 local Msg = require 'feather.message'
 local Virtual = require 'feather.virtual'
 local Closure = require 'feather.closure' 
-local C = terralib.includecstring [[#include <stdio.h>]]
+local C = require 'feather.libc'
 local Expression = require 'feather.expression'
 
 local M = {}
@@ -366,14 +366,32 @@ function M.basic_template(params)
         end,
         update = function(self, context, environment)
           return quote
+            -- Windows only redraw if something changed, so compare every parameter to what was last rendered
+            var changed = false
             escape
               for i, name in ipairs(params_abbrev.names) do
-                emit quote self._0.[name] = [environment[name] ] end
+                emit quote
+                  var value = [environment[name] ]
+                  if C.memcmp(&self._0.[name], &value, sizeof([type_environment[name] ])) ~= 0 then
+                    changed = true
+                  end
+                  self._0.[name] = value
+                end
+              end
+            end
+            var pos, ext, rot = [environment.pos], [environment.ext], [environment.rot]
+            if C.memcmp(&self._2.pos, &pos, sizeof(F.Vec3)) ~= 0 or C.memcmp(&self._2.extent, &ext, sizeof(F.Vec3)) ~= 0 or
+               C.memcmp(&self._2.rot, &rot, sizeof(F.Vec3)) ~= 0 then
+              changed = true
+            end
+            self._2.pos = pos
+            self._2.extent = ext
+            self._2.rot = rot
+            escape
+              if context.changed then
+                emit quote if changed then @[context.changed] = true end end
               end
             end
-            self._2.pos = [environment.pos]
-            self._2.extent = [environment.ext]
-            self._2.rot = [environment.rot]
             var local_transform = M.transform{self._2.pos}
             var transform = [context.transform]:compose(&local_transform)
             escape
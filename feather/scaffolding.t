@@ -42,7 +42,9 @@ function M.simple_application(executable_name, application, ui, flags)
     u:init(&a, [ui.query_store]{}, b)
 
     u:enter()
-    while b:ProcessMessages() ~= 0 do
+    -- Sleep until something happens instead of spinning. Applications with their own timers can say when they next
+    -- need to update by defining a timeout method that returns seconds, otherwise we only wake up for events and frames.
+    while b:WaitMessages([application.methods.timeout and `a:timeout() or `-1.0]) ~= 0 do
       a:update()
       u:update()
     end
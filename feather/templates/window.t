@@ -4,6 +4,7 @@ local override = require 'feather.util'.override
 local messages = require 'feather.messages'
 local Msg = require 'feather.message'
 local Virtual = require 'feather.virtual'
+local C = require 'feather.libc'
 
 local gen_window_node = terralib.memoize(function(body_type, rtree_node, window_base)
   local struct window_node(Virtual.extends(window_base)) {
@@ -37,13 +38,14 @@ return core.raw_template {
       }
     end
 
-    local function override_context(self, context)
+    local function override_context(self, context, changed)
       return override(context, {
         rtree = `self.rtree,
         rtree_node = `self.rtree.root,
         allocator = `self.rtree.allocator,
         window = `self.window,
         transform = `core.transform.identity(),
+        changed = changed, -- Set to true by any element whose parameters changed during an update
       })
     end
 
@@ -62,14 +64,20 @@ return core.raw_template {
           self.window = [context.backend]:CreateWindow(self.node.data, nil, &pos, &size, "feather window", messages.WindowFlag.RESIZABLE)
           self.color = environment.color
           [body_fns.enter(`self.body, override_context(self, context), environment)]
+          [context.backend]:DirtyRect(self.window, nil)
         end
       end,
       update = function(self, context, environment)
         return quote
           var transform = core.transform.identity()
-          self.color = environment.color
-          [body_fns.update(`self.body, override_context(self, context), environment)]
-          [context.backend]:DirtyRect(self.window, nil) --TODO: make this smart enough to only call for a redraw if something changed.
+          var color = [environment.color]
+          var changed = C.memcmp(&self.color, &color, sizeof(F.Color)) ~= 0
+          self.color = color
+          [body_fns.update(`self.body, override_context(self, context, `&changed), environment)]
+          -- Updates run whenever WaitMessages wakes up, so only ask for a frame if the element tree actually changed
+          if changed then
+            [context.backend]:DirtyRect(self.window, nil)
+          end
         end
       end,
       exit = function(self, context)
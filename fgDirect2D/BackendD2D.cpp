@@ -134,6 +134,9 @@ FG_Err Backend::PopLayer(FG_Backend* self, FG_Window* window)
   return 0;
 }
 
+// ID2D1Layer doesn't retain its contents between frames, so there is never anything cached to invalidate.
+FG_Err Backend::InvalidateLayer(FG_Backend* self, FG_Window* window, FG_Asset* layer, FG_Rect* area) { return 0; }
+
 FG_Err Backend::SetRenderTarget(FG_Backend* self, FG_Window* window, FG_Asset* target) { return -1; }
 
 FG_Err Backend::PushClip(FG_Backend* self, FG_Window* window, FG_Rect* area)
@@ -222,6 +225,13 @@ FG_Err Backend::DestroyFont(FG_Backend* self, FG_Font* font)
     return -1;
   return 0;
 }
+// DirectWrite rasterizes and caches glyphs itself, so there is nothing to prepare
+FG_Err Backend::PrewarmFont(FG_Backend* self, FG_Font* font, const char* text, uint32_t first, uint32_t last)
+{
+  return 0;
+}
+// DirectWrite already falls back on system fonts for missing characters
+FG_Err Backend::SetFontFallback(FG_Backend* self, FG_Font* font, FG_Font** fallbacks, uint32_t count) { return 0; }
 FG_Err Backend::DestroyLayout(FG_Backend* self, void* layout)
 {
   if(!layout)
@@ -625,6 +635,19 @@ FG_Err Backend::ProcessMessages(FG_Backend* self)
   return 1;
 }
 
+FG_Err Backend::WaitMessages(FG_Backend* self, double timeout)
+{
+  // Returns as soon as anything is in the queue, including the WM_NULL posted by Wake()
+  DWORD ms = (timeout < 0.0) ? INFINITE : static_cast<DWORD>(timeout * 1000.0);
+  MsgWaitForMultipleObjectsEx(0, nullptr, ms, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+  return ProcessMessages(self);
+}
+
+FG_Err Backend::Wake(FG_Backend* self)
+{
+  return PostThreadMessageW(static_cast<Backend*>(self)->_thread, WM_NULL, 0, 0) ? 0 : -1;
+}
+
 FG_Err Backend::SetCursorD2D(FG_Backend* self, FG_Window* window, FG_Cursor cursor)
 {
   static HCURSOR hArrow    = LoadCursor(NULL, IDC_ARROW);
@@ -948,12 +971,16 @@ extern "C" FG_COMPILER_DLLEXPORT FG_Backend* fgDirect2D(void* root, FG_Log log,
 
 Backend::Backend(void* root, FG_Log log, FG_Behavior behavior, ID2D1Factory1* factory, IWICImagingFactory* wicfactory,
                  IDWriteFactory1* writefactory) :
-  _root(root), _log(log), _behavior(behavior), _factory(factory), _wicfactory(wicfactory), _writefactory(writefactory)
+  _root(root), _log(log), _behavior(behavior), _factory(factory), _wicfactory(wicfactory), _writefactory(writefactory),
+  _thread(GetCurrentThreadId())
 {
   draw                 = &DrawD2D;
   clear                = &Clear;
   pushLayer            = &PushLayer;
   popLayer             = &PopLayer;
+  invalidateLayer      = &InvalidateLayer;
+  prewarmFont          = &PrewarmFont;
+  setFontFallback      = &SetFontFallback;
   pushClip             = &PushClip;
   popClip              = &PopClip;
   dirtyRect            = &DirtyRect;
@@ -977,6 +1004,8 @@ Backend::Backend(void* root, FG_Log log, FG_Behavior behavior, ID2D1Factory1* fa
   checkClipboard       = &CheckClipboard;
   clearClipboard       = &ClearClipboard;
   processMessages      = &ProcessMessages;
+  waitMessages         = &WaitMessages;
+  wake                 = &Wake;
   setCursor            = &SetCursorD2D;
   getDisplayIndex      = &GetDisplayIndex;
   getDisplay           = &GetDisplay;
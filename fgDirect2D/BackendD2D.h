@@ -47,6 +47,7 @@ namespace D2D {
     static FG_Err PushLayer(FG_Backend* self, FG_Window* window, FG_Asset* layer, float* transform, float opacity,
                             FG_BlendState* blend);
     static FG_Err PopLayer(FG_Backend* self, FG_Window* window);
+    static FG_Err InvalidateLayer(FG_Backend* self, FG_Window* window, FG_Asset* layer, FG_Rect* area);
     static FG_Err SetRenderTarget(FG_Backend* self, FG_Window* window, FG_Asset* target);
     static FG_Err PushClip(FG_Backend* self, FG_Window* window, FG_Rect* area);
     static FG_Err PopClip(FG_Backend* self, FG_Window* window);
@@ -58,6 +59,8 @@ namespace D2D {
     static FG_Font* CreateFontD2D(FG_Backend* self, const char* family, unsigned short weight, bool italic, unsigned int pt,
                                   FG_Vec dpi, FG_AntiAliasing aa);
     static FG_Err DestroyFont(FG_Backend* self, FG_Font* font);
+    static FG_Err PrewarmFont(FG_Backend* self, FG_Font* font, const char* text, uint32_t first, uint32_t last);
+    static FG_Err SetFontFallback(FG_Backend* self, FG_Font* font, FG_Font** fallbacks, uint32_t count);
     static void* FontLayout(FG_Backend* self, FG_Font* font, const char* text, FG_Rect* area, float lineHeight,
                             float letterSpacing, FG_BreakStyle breakStyle, void* prev);
     static FG_Err DestroyLayout(FG_Backend* self, void* layout);
@@ -73,6 +76,8 @@ namespace D2D {
     static bool CheckClipboard(FG_Backend* self, FG_Window* window, FG_Clipboard kind);
     static FG_Err ClearClipboard(FG_Backend* self, FG_Window* window, FG_Clipboard kind);
     static FG_Err ProcessMessages(FG_Backend* self);
+    static FG_Err WaitMessages(FG_Backend* self, double timeout);
+    static FG_Err Wake(FG_Backend* self);
     static FG_Err SetCursorD2D(FG_Backend* self, FG_Window* window, FG_Cursor cursor);
     static FG_Err GetDisplayIndex(FG_Backend* self, unsigned int index, FG_Display* out);
     static FG_Err GetDisplay(FG_Backend* self, void* handle, FG_Display* out);
@@ -110,6 +115,7 @@ namespace D2D {
     IDWriteFactory1* _writefactory;
     CompactArray<FG_Display> _displays;
     FG_Behavior _behavior;
+    unsigned long _thread; // Thread that owns the message queue, so Wake() can post to it
     long(__stdcall* getDpiForMonitor)(struct HMONITOR__*, int, unsigned int*, unsigned int*);
     long(__stdcall* getScaleFactorForMonitor)(struct HMONITOR__*, int*);
 
@@ -30,6 +30,18 @@ namespace GL {
     float posUV[4];
     float color[4];
   };
+
+  // Per-instance attributes of a batched shape, laid out to match standard_instanced.vs.glsl
+  struct ShapeInstance
+  {
+    float mvp[4][4];
+    float dimBorderBlur[4];
+    float corners[4];
+    float fill[4];
+    float outline[4];
+    float inflate[2];
+    float shape; // ShapeKind, only read by the uber shader
+  };
 }
 
 #endif
\ No newline at end of file
@@ -4,9 +4,11 @@
 #include "platform.h"
 #include "BackendGL.h"
 #include "Font.h"
+#include "LineBreak.h"
 #include "linmath.h"
 #include "utf.h"
 #include <float.h>
+#include <algorithm>
 #include "SOIL.h"
 #include "ft2build.h"
 #include FT_FREETYPE_H
@@ -47,6 +49,14 @@ FG_Err Backend::DrawGL(FG_Backend* self, FG_Window* window, FG_Command* commandl
   for(unsigned int i = 0; i < n_commands; ++i)
   {
     auto& c = commandlist[i];
+
+    // Shapes and text are queued up so runs of them can be merged, which means a pending run has to be drawn before
+    // any other kind of command to preserve ordering
+    if(c.category < FG_Category_RECT || c.category > FG_Category_TRIANGLE)
+      context->FlushShapes();
+    if(c.category != FG_Category_TEXT)
+      context->FlushText();
+
     switch(c.category)
     {
     case FG_Category_ARC:
@@ -84,6 +94,9 @@ FG_Err Backend::DrawGL(FG_Backend* self, FG_Window* window, FG_Command* commandl
     default: return ERR_UNKNOWN_COMMAND_CATEGORY;
     }
   }
+
+  context->FlushShapes();
+  context->FlushText();
   return ERR_SUCCESS;
 }
 
@@ -104,7 +117,16 @@ FG_Err Backend::PushLayer(FG_Backend* self, FG_Window* window, FG_Asset* layer,
 {
   if(!self || !window)
     return ERR_MISSING_PARAMETER;
-  static_cast<Context*>(window)->PushLayer(static_cast<Layer*>(layer), transform, opacity, blend);
+  return static_cast<Context*>(window)->PushLayer(static_cast<Layer*>(layer), transform, opacity, blend);
+}
+
+FG_Err Backend::InvalidateLayer(FG_Backend* self, FG_Window* window, FG_Asset* layer, FG_Rect* area)
+{
+  if(!self || !layer)
+    return ERR_MISSING_PARAMETER;
+  if(layer->format != FG_Format_LAYER)
+    return ERR_INVALID_KIND;
+  static_cast<Layer*>(layer)->Invalidate(area);
   return ERR_SUCCESS;
 }
 
@@ -175,46 +197,168 @@ FG_Err Backend::DestroyFont(FG_Backend* self, FG_Font* font)
   delete static_cast<Font*>(font);
   return ERR_SUCCESS;
 }
+
+FG_Err Backend::PrewarmFont(FG_Backend* self, FG_Font* font, const char* text, uint32_t first, uint32_t last)
+{
+  if(!self || !font)
+    return ERR_MISSING_PARAMETER;
+
+  std::vector<char32_t> codepoints;
+  if(text)
+  {
+    codepoints.resize(UTF8toUTF32(text, -1, nullptr, 0));
+    codepoints.resize(UTF8toUTF32(text, -1, codepoints.data(), codepoints.size()));
+    codepoints.resize(std::find(codepoints.begin(), codepoints.end(), 0) - codepoints.begin());
+  }
+  for(uint32_t c = first; c < last; ++c)
+    codepoints.push_back(c);
+
+  static_cast<Font*>(font)->Prewarm(codepoints.data(), codepoints.size());
+  return ERR_SUCCESS;
+}
+FG_Err Backend::SetFontFallback(FG_Backend* self, FG_Font* font, FG_Font** fallbacks, uint32_t count)
+{
+  if(!self || !font || (count > 0 && !fallbacks))
+    return ERR_MISSING_PARAMETER;
+
+  std::vector<Font*> chain;
+  for(uint32_t i = 0; i < count; ++i)
+    chain.push_back(static_cast<Font*>(fallbacks[i]));
+  static_cast<Font*>(font)->SetFallback(chain.data(), chain.size());
+  return ERR_SUCCESS;
+}
+
 FG_Err Backend::DestroyLayout(FG_Backend* self, void* layout)
 {
   if(!self || !layout)
     return ERR_MISSING_PARAMETER;
   free(reinterpret_cast<TextLayout*>(layout)->text);
-  free(layout);
+  delete reinterpret_cast<TextLayout*>(layout);
   return ERR_SUCCESS;
 }
 
+// Shapes a line without the line break it ends with
+static std::shared_ptr<const ShapedRun> ShapeLine(Font* font, const char32_t* line, size_t len)
+{
+  while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+    --len;
+  return font->Shape(line, len);
+}
+
+// Width of a line as it will be drawn, leaving out the line break and the spaces allowed to hang past the edge
+static float ShapedWidth(const ShapedRun& run, const char32_t* line, size_t len, float letterspacing)
+{
+  while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || LineBreaker::Classify(line[len - 1]) == BREAK_SP))
+    --len;
+
+  float width = 0.0f;
+  for(auto& g : run.glyphs)
+    if(g.cluster < len)
+      width += g.advance + letterspacing;
+  return width;
+}
+
 void* Backend::FontLayout(FG_Backend* self, FG_Font* font, const char* text, FG_Rect* area, float lineHeight,
                           float letterSpacing, FG_BreakStyle breakStyle, void* prev)
 {
-  DestroyLayout(self, prev); // Figuring out if prev can be reused ends up being too costly to bother with
-
-  // Simple layout to be replaced by Harfbuzz and moved into feather eventually
-  std::vector<const char32_t*> breaks;
+  // Lines are broken with simple per-character measurements, then each line is shaped by HarfBuzz
+  auto layout    = new TextLayout();
+  auto old       = reinterpret_cast<TextLayout*>(prev);
   Font* f        = static_cast<Font*>(font);
   float maxwidth = area->right - area->left;
-  size_t len     = strlen(text) + 1;
-  char32_t* utf  = (char32_t*)malloc(len * sizeof(char32_t)); // overallocate for UTF32
-  UTF8toUTF32(text, len, utf, len);
-  const char32_t* cur = utf;
+  size_t len     = strlen(text);
+  size_t count   = !len ? 1 : UTF8toUTF32(text, len, nullptr, 0); // Includes room for the terminator
+  char32_t* utf  = (char32_t*)malloc(count * sizeof(char32_t));
+  count          = UTF8toUTF32(text, len, utf, count - 1); // Stops early on invalid UTF-8
+  utf[count]     = 0;
 
-  do
-  {
-    breaks.push_back(cur);
-    f->GetLineWidth(cur, maxwidth, breakStyle, letterSpacing);
-  } while(*cur);
-
-  auto layout           = reinterpret_cast<TextLayout*>(malloc(sizeof(TextLayout) + (breaks.size() * sizeof(char32_t*))));
   layout->text          = utf;
-  layout->lines         = reinterpret_cast<const char32_t**>(layout + 1);
-  layout->n_lines       = breaks.size();
+  layout->length        = count;
+  layout->font          = f;
+  layout->generation    = f->GetGeneration();
   layout->area          = *area;
   layout->lineheight    = lineHeight;
   layout->letterspacing = letterSpacing;
   layout->breakstyle    = breakStyle;
-  for(size_t i = 0; i < breaks.size(); ++i)
-    layout->lines[i] = breaks[i];
 
+  // Where a line starts only depends on the text after the previous break, so if prev was broken the same way, every
+  // line before the edit can be kept, and once a new break lands on an old one past the edit, so can the rest.
+  // Runs shaped before the font's fallback chain changed may point at glyphs of a font that's no longer in it.
+  const bool reuse = old && old->font == f && old->generation == f->GetGeneration() &&
+                     old->area.right - old->area.left == maxwidth && old->breakstyle == breakStyle &&
+                     old->letterspacing == letterSpacing;
+  size_t prefix = 0;
+  size_t suffix = 0;
+  size_t first  = 0;
+
+  if(reuse)
+  {
+    const size_t common = std::min(old->length, layout->length);
+    while(prefix < common && old->text[prefix] == utf[prefix])
+      ++prefix;
+    while(suffix < common - prefix && old->text[old->length - suffix - 1] == utf[layout->length - suffix - 1])
+      ++suffix;
+
+    // The line before the edit is broken again too, since a shorter word might fit on it now
+    first = std::upper_bound(old->lines.begin(), old->lines.end(), old->text + prefix) - old->lines.begin();
+    first = first > 1 ? first - 2 : 0;
+    for(size_t i = 0; i < first; ++i)
+    {
+      layout->lines.push_back(utf + (old->lines[i] - old->text));
+      layout->runs.push_back(old->runs[i]);
+    }
+  }
+
+  // Lines are only ever broken again from old->lines[first] onwards, so nothing before it gets measured
+  const size_t base = reuse ? old->lines[first] - old->text : 0;
+  const bool wrap   = breakStyle != FG_BreakStyle_NONE && maxwidth >= 0.0f;
+  LineBreaker breaker(utf, layout->length, base, maxwidth, letterSpacing, breakStyle, &Font::Measure, f);
+  size_t offset = base;
+  do
+  {
+    if(suffix > 0 && offset >= layout->length - suffix)
+    {
+      auto same = old->text + (offset + old->length - layout->length);
+      auto line = std::lower_bound(old->lines.begin(), old->lines.end(), same);
+      if(line != old->lines.end() && *line == same)
+      {
+        for(; line != old->lines.end(); ++line)
+        {
+          layout->lines.push_back(utf + (*line - same) + offset);
+          layout->runs.push_back(old->runs[line - old->lines.begin()]);
+        }
+        break;
+      }
+    }
+
+    size_t next = breaker.Next(offset);
+    auto run    = ShapeLine(f, utf + offset, next - offset);
+
+    // Shaping can make a line wider than its measurements, through ligatures and GPOS kerning the kern table doesn't
+    // have. If it no longer fits, it's broken again with the limit lowered by however much it overflowed.
+    float limit = maxwidth;
+    while(wrap && next > offset + 1)
+    {
+      float over = ShapedWidth(*run, utf + offset, next - offset, letterSpacing) - maxwidth;
+      if(over <= 0.0f)
+        break;
+      limit          = std::max(limit - over, 0.0f);
+      size_t shorter = breaker.Next(offset, limit);
+      if(shorter < next)
+      {
+        next = shorter;
+        run  = ShapeLine(f, utf + offset, next - offset);
+      }
+      else if(limit <= 0.0f)
+        break;
+    }
+
+    layout->lines.push_back(utf + offset);
+    layout->runs.push_back(std::move(run));
+    offset = next;
+  } while(offset < layout->length);
+
+  DestroyLayout(self, prev);
   return layout;
 }
 uint32_t Backend::FontIndex(FG_Backend* self, FG_Font* font, void* fontlayout, FG_Rect* area, FG_Vec pos, FG_Vec* cursor)
@@ -223,8 +367,7 @@ uint32_t Backend::FontIndex(FG_Backend* self, FG_Font* font, void* fontlayout, F
     return ~0U;
   auto layout = reinterpret_cast<TextLayout*>(fontlayout);
   Font* f     = static_cast<Font*>(font);
-  auto r =
-    f->GetIndex(layout->text, area->right - area->left, layout->breakstyle, layout->lineheight, layout->letterspacing, pos);
+  auto r      = f->GetIndex(*layout, pos);
   cursor->x = r.second.x;
   cursor->y = r.second.y;
   return r.first;
@@ -236,8 +379,7 @@ FG_Vec Backend::FontPos(FG_Backend* self, FG_Font* font, void* fontlayout, FG_Re
     return { NAN, NAN };
   auto layout = reinterpret_cast<TextLayout*>(fontlayout);
   Font* f     = static_cast<Font*>(font);
-  auto r =
-    f->GetPos(layout->text, area->right - area->left, layout->breakstyle, layout->lineheight, layout->letterspacing, index);
+  auto r      = f->GetPos(*layout, index);
   FG_Vec c = { r.second.x, r.second.y };
   return c;
 }
@@ -567,14 +709,80 @@ FG_Err Backend::ClearClipboard(FG_Backend* self, FG_Window* window, FG_Clipboard
 #endif
 }
 
+// Returns the earliest time a window with pending damage is due for its next frame, or -1 if there is no damage
+double Backend::NextFrame() const
+{
+  double next = -1.0;
+  for(Window* w = _windows; w != nullptr; w = w->_next)
+  {
+    if(!w->_damage.empty())
+      next = (next < 0.0) ? w->_nextframe : std::min(next, w->_nextframe);
+  }
+  return next;
+}
+
+FG_Err Backend::DrawFrames()
+{
+  // Windows only collect damage while handling events, so this is where it actually gets drawn
+  double now = glfwGetTime();
+
+  // Only the last window drawn waits for vertical blank. If every window did, each swap would wait for its own vblank
+  // and N windows would only get refresh/N frames, so the scheduler paces the rest instead.
+  Window* last = nullptr;
+  for(Window* w = _windows; w != nullptr; w = w->_next)
+  {
+    if(!w->_damage.empty() && w->GetWindow() && now >= w->_nextframe)
+      last = w;
+  }
+
+  for(Window* w = _windows; w != nullptr; w = w->_next)
+    w->DrawDamage(now, w == last);
+
+  // TODO: Process all joystick events
+
+  return _windows != nullptr;
+}
+
 FG_Err Backend::ProcessMessages(FG_Backend* self)
 {
   auto backend = static_cast<Backend*>(self);
-  glfwPollEvents();
 
-  // TODO: Process all joystick events
+  // If a window is waiting on its next frame, sleep until then instead of spinning, but still wake up for new events
+  double now  = glfwGetTime();
+  double next = backend->NextFrame();
+  if(next > now)
+    glfwWaitEventsTimeout(next - now);
+  else
+    glfwPollEvents();
 
-  return backend->_windows != nullptr;
+  return backend->DrawFrames();
+}
+
+FG_Err Backend::WaitMessages(FG_Backend* self, double timeout)
+{
+  auto backend = static_cast<Backend*>(self);
+
+  // Sleep until the timeout or the next frame, whichever comes first. Events and Wake() interrupt the wait.
+  double now      = glfwGetTime();
+  double deadline = (timeout < 0.0) ? -1.0 : now + timeout;
+  double next     = backend->NextFrame();
+  if(next >= 0.0)
+    deadline = (deadline < 0.0) ? next : std::min(deadline, next);
+
+  if(deadline < 0.0)
+    glfwWaitEvents();
+  else if(deadline > now)
+    glfwWaitEventsTimeout(deadline - now);
+  else
+    glfwPollEvents();
+
+  return backend->DrawFrames();
+}
+
+FG_Err Backend::Wake(FG_Backend* self)
+{
+  glfwPostEmptyEvent();
+  return 0;
 }
 
 FG_Err Backend::SetCursorGL(FG_Backend* self, FG_Window* window, FG_Cursor cursor)
@@ -662,6 +870,7 @@ FG_Window* Backend::CreateWindowGL(FG_Backend* self, FG_MsgReceiver* element, vo
   _lasterr     = 0;
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, backend->_debugcallback);
   Window* window =
     new Window(static_cast<Backend*>(self), reinterpret_cast<GLFWmonitor*>(display), element, pos, dim, flags, caption);
 
@@ -781,8 +990,13 @@ void DestroyGL(FG_Backend* self)
   }
 }
 
+#ifndef FG_GL_NO_ERROR_CHECKS
 bool Backend::LogError(const char* call)
 {
+  // The debug callback already reports every error, and polling glGetError can stall the pipeline
+  if(_debugcallback)
+    return false;
+
   int err = glGetError();
   if(err != GL_NO_ERROR)
   {
@@ -792,6 +1006,27 @@ bool Backend::LogError(const char* call)
 
   return false;
 }
+#endif
+
+void GLAD_API_PTR Backend::DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                         const GLchar* message, const void* userParam)
+{
+  auto backend = static_cast<const Backend*>(userParam);
+  FG_Level level;
+  switch(severity)
+  {
+  case GL_DEBUG_SEVERITY_HIGH: level = FG_Level_ERROR; break;
+  case GL_DEBUG_SEVERITY_MEDIUM: level = FG_Level_WARNING; break;
+  case GL_DEBUG_SEVERITY_LOW: level = FG_Level_NOTICE; break;
+  default: level = FG_Level_DEBUG; break;
+  }
+
+  // Errors are always high severity, but some drivers report them lower
+  if(type == GL_DEBUG_TYPE_ERROR)
+    level = FG_Level_ERROR;
+
+  (*backend->_log)(backend->_root, level, "GL 0x%X: %.*s", id, static_cast<int>(length), message);
+}
 
 extern "C" FG_COMPILER_DLLEXPORT FG_Backend* fgOpenGL(void* root, FG_Log log, FG_Behavior behavior)
 {
@@ -869,6 +1104,9 @@ Backend::Backend(void* root, FG_Log log, FG_Behavior behavior) :
   clear                = &Clear;
   pushLayer            = &PushLayer;
   popLayer             = &PopLayer;
+  invalidateLayer      = &InvalidateLayer;
+  prewarmFont          = &PrewarmFont;
+  setFontFallback      = &SetFontFallback;
   pushClip             = &PushClip;
   popClip              = &PopClip;
   dirtyRect            = &DirtyRect;
@@ -892,6 +1130,8 @@ Backend::Backend(void* root, FG_Log log, FG_Behavior behavior) :
   checkClipboard       = &CheckClipboard;
   clearClipboard       = &ClearClipboard;
   processMessages      = &ProcessMessages;
+  waitMessages         = &WaitMessages;
+  wake                 = &Wake;
   setCursor            = &SetCursorGL;
   getDisplayIndex      = &GetDisplayIndex;
   getDisplay           = &GetDisplay;
@@ -904,6 +1144,7 @@ Backend::Backend(void* root, FG_Log log, FG_Behavior behavior) :
   createSystemControl  = &CreateSystemControl;
   setSystemControl     = &SetSystemControl;
   destroySystemControl = &DestroySystemControl;
+  features             = static_cast<FG_Feature>(0); // Contexts add the features their driver supports
 
   (*_log)(_root, FG_Level_NONE, "Initializing fgOpenGL...");
   if(FT_Error err = FT_Init_FreeType(&_ftlib))
@@ -921,6 +1162,15 @@ Backend::Backend(void* root, FG_Log log, FG_Behavior behavior) :
   _imageshader =
     Shader(image_fs, image_vs, 0, { { FG_ShaderType_FLOAT, 4, 4, "MVP" }, { FG_ShaderType_TEXTURE, 0, 0, "texture" } });
 
+  const char* sdf_fs =
+#include "TextSDF.fs.glsl"
+    ;
+
+  _sdfshader = Shader(sdf_fs, image_vs, 0,
+                      { { FG_ShaderType_FLOAT, 4, 4, "MVP" },
+                        { FG_ShaderType_TEXTURE, 0, 0, "texture" },
+                        { FG_ShaderType_FLOAT, 1, 1, "Blur" } });
+
   const char* line_vs =
 #include "Line.vs.glsl"
     ;
@@ -955,7 +1205,7 @@ Backend::Backend(void* root, FG_Log log, FG_Behavior behavior) :
   std::initializer_list<FG_ShaderParameter> standardLayout = {
     { FG_ShaderType_FLOAT, 4, 4, "MVP" },     { FG_ShaderType_FLOAT, 4, 1, "DimBorderBlur" },
     { FG_ShaderType_FLOAT, 4, 1, "Corners" }, { FG_ShaderType_FLOAT, 4, 1, "Fill" },
-    { FG_ShaderType_FLOAT, 4, 1, "Outline" },
+    { FG_ShaderType_FLOAT, 4, 1, "Outline" }, { FG_ShaderType_FLOAT, 2, 1, "Inflate" },
   };
 
   _rectshader   = Shader(roundrect_fs, standard_vs, 0, standardLayout);
@@ -963,6 +1213,37 @@ Backend::Backend(void* root, FG_Log log, FG_Behavior behavior) :
   _circleshader = Shader(circle_fs, standard_vs, 0, standardLayout);
   _arcshader    = Shader(arc_fs, standard_vs, 0, standardLayout);
 
+  const char* instanced_vs =
+#include "standard_instanced.vs.glsl"
+    ;
+
+  // The instanced shaders get their per-shape values from varyings instead of uniforms
+  auto instanced = [](const char* src) {
+    std::string fs(src);
+    for(size_t i = fs.find("uniform vec4 "); i != std::string::npos; i = fs.find("uniform vec4 ", i))
+      fs.replace(i, 7, "varying");
+    return fs;
+  };
+
+  _instancedshaders[SHAPE_RECT]     = Shader(instanced(roundrect_fs).c_str(), instanced_vs, 0, {});
+  _instancedshaders[SHAPE_CIRCLE]   = Shader(instanced(circle_fs).c_str(), instanced_vs, 0, {});
+  _instancedshaders[SHAPE_ARC]      = Shader(instanced(arc_fs).c_str(), instanced_vs, 0, {});
+  _instancedshaders[SHAPE_TRIANGLE] = Shader(instanced(triangle_fs).c_str(), instanced_vs, 0, {});
+
+  const char* uber_fs =
+#include "Uber.fs.glsl"
+    ;
+
+  _ubershader       = Shader(uber_fs, instanced_vs, 0, {});
+  const char* uber  = getenv("FEATHER_GL_UBERSHADER");
+  _uberenabled      = !uber || strcmp(uber, "0") != 0;
+  const char* dbg   = getenv("FEATHER_GL_DEBUG");
+  _debugcallback    = dbg && strcmp(dbg, "0") != 0;
+  const char* cap   = getenv("FEATHER_GL_FRAMECAP");
+  _frametime        = (cap && atof(cap) > 0.0) ? 1.0 / atof(cap) : 0.0;
+  const char* stats = getenv("FEATHER_GL_STATS");
+  _logstats         = stats && strcmp(stats, "0") != 0;
+
 #ifdef FG_PLATFORM_WIN32
   #ifdef FG_DEBUG
   HeapSetInformation(NULL, HeapEnableTerminationOnCorruption, NULL, 0);
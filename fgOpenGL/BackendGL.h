@@ -18,6 +18,8 @@ limitations under the License.
 #define FG__OPENGL_H
 
 #include "Window.h"
+#include "GlyphWorkers.h"
+#include "FaceCache.h"
 #include <vector>
 
 struct FT_LibraryRec_;
@@ -45,7 +47,13 @@ namespace GL {
     Backend(void* root, FG_Log log, FG_Behavior behavior);
     ~Backend();
     FG_Result Behavior(Context* data, const FG_Msg& msg);
+    double NextFrame() const;
+    FG_Err DrawFrames();
+#ifdef FG_GL_NO_ERROR_CHECKS
+    inline bool LogError(const char* call) { return false; }
+#else
     bool LogError(const char* call);
+#endif
 
     static FG_Err DrawGL(FG_Backend* self, FG_Window* window, FG_Command* commandlist, unsigned int n_commands,
                          FG_BlendState* blend);
@@ -53,6 +61,7 @@ namespace GL {
     static FG_Err PushLayer(FG_Backend* self, FG_Window* window, FG_Asset* layer, float* transform, float opacity,
                             FG_BlendState* blend);
     static FG_Err PopLayer(FG_Backend* self, FG_Window* window);
+    static FG_Err InvalidateLayer(FG_Backend* self, FG_Window* window, FG_Asset* layer, FG_Rect* area);
     static FG_Err SetRenderTarget(FG_Backend* self, FG_Window* window, FG_Asset* target);
     static FG_Err PushClip(FG_Backend* self, FG_Window* window, FG_Rect* area);
     static FG_Err PopClip(FG_Backend* self, FG_Window* window);
@@ -64,6 +73,8 @@ namespace GL {
     static FG_Font* CreateFontGL(FG_Backend* self, const char* family, unsigned short weight, bool italic, unsigned int pt,
                                  FG_Vec dpi, FG_AntiAliasing aa);
     static FG_Err DestroyFont(FG_Backend* self, FG_Font* font);
+    static FG_Err PrewarmFont(FG_Backend* self, FG_Font* font, const char* text, uint32_t first, uint32_t last);
+    static FG_Err SetFontFallback(FG_Backend* self, FG_Font* font, FG_Font** fallbacks, uint32_t count);
     static void* FontLayout(FG_Backend* self, FG_Font* font, const char* text, FG_Rect* area, float lineHeight,
                             float letterSpacing, FG_BreakStyle breakStyle, void* prev);
     static FG_Err DestroyLayout(FG_Backend* self, void* layout);
@@ -79,6 +90,8 @@ namespace GL {
     static bool CheckClipboard(FG_Backend* self, FG_Window* window, FG_Clipboard kind);
     static FG_Err ClearClipboard(FG_Backend* self, FG_Window* window, FG_Clipboard kind);
     static FG_Err ProcessMessages(FG_Backend* self);
+    static FG_Err WaitMessages(FG_Backend* self, double timeout);
+    static FG_Err Wake(FG_Backend* self);
     static FG_Err SetCursorGL(FG_Backend* self, FG_Window* window, FG_Cursor cursor);
     static FG_Err GetDisplayIndex(FG_Backend* self, unsigned int index, FG_Display* out);
     static FG_Err GetDisplay(FG_Backend* self, void* handle, FG_Display* out);
@@ -96,17 +109,29 @@ namespace GL {
     static FG_Err DestroySystemControl(FG_Backend* self, FG_Window* window, void* control);
     static void ErrorCallback(int error, const char* description);
     static void JoystickCallback(int id, int connected);
+    // GLDEBUGPROC is stdcall on 32-bit Windows, so the callback has to use the same calling convention
+    static void GLAD_API_PTR DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                           const GLchar* message, const void* userParam);
 
     FG_Log _log;
     void* _root;
     Window* _windows;
     Shader _imageshader; // used for text
+    Shader _sdfshader;   // used for FG_AntiAliasing_SDF text
     Shader _rectshader;
     Shader _circleshader;
     Shader _arcshader;
     Shader _trishader;
     Shader _lineshader;
+    Shader _instancedshaders[SHAPE_COUNT]; // Instanced variants of the shape shaders, indexed by ShapeKind
+    Shader _ubershader;                    // Draws any ShapeKind based on the per-instance shape id
+    bool _uberenabled;                     // Set FEATHER_GL_UBERSHADER=0 to use the per-shape programs instead
+    bool _debugcallback; // Set FEATHER_GL_DEBUG=1 to get errors from KHR_debug instead of polling glGetError
+    double _frametime;   // Minimum seconds between frames. Set FEATHER_GL_FRAMECAP to a frame rate to limit it.
+    bool _logstats;      // Set FEATHER_GL_STATS=1 to log each frame's DrawStats at FG_Level_DEBUG
     struct FT_LibraryRec_* _ftlib;
+    FaceCache _faces; // Declared first so the workers are gone before the font data is unmapped
+    GlyphWorkers _workers;
 
     static int _lasterr;
     static int _refcount;
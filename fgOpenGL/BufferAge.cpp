@@ -0,0 +1,57 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "compiler.h"
+#include "glad/gl.h"
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#if defined(FG_PLATFORM_POSIX) && !defined(__APPLE__)
+  #define GLFW_EXPOSE_NATIVE_X11
+  #define GLFW_EXPOSE_NATIVE_GLX
+  #include "GLFW/glfw3native.h"
+  #include <string.h>
+  #ifndef GLX_BACK_BUFFER_AGE_EXT
+    #define GLX_BACK_BUFFER_AGE_EXT 0x20F4
+  #endif
+  #define FG_GL_BUFFER_AGE
+#endif
+
+namespace GL {
+#ifdef FG_GL_BUFFER_AGE
+  // Buffer age is only queried through GLX, so Wayland windows and X11 windows with an EGL context report 0 and fall
+  // back to full redraws.
+  static Display* GetGLXDisplay(GLFWwindow* window)
+  {
+  #ifdef GLFW_PLATFORM_X11
+    if(glfwGetPlatform() != GLFW_PLATFORM_X11)
+      return nullptr;
+  #endif
+    if(!glfwGetGLXWindow(window))
+      return nullptr;
+    return glfwGetX11Display();
+  }
+#endif
+
+  bool HasBufferAge(GLFWwindow* window)
+  {
+#ifdef FG_GL_BUFFER_AGE
+    if(Display* x11 = GetGLXDisplay(window))
+    {
+      const char* ext = glXQueryExtensionsString(x11, DefaultScreen(x11));
+      return ext && strstr(ext, "GLX_EXT_buffer_age") != nullptr;
+    }
+#endif
+    return false;
+  }
+
+  unsigned int GetBufferAge(GLFWwindow* window)
+  {
+    unsigned int age = 0;
+#ifdef FG_GL_BUFFER_AGE
+    if(Display* x11 = GetGLXDisplay(window))
+      glXQueryDrawable(x11, glfwGetGLXWindow(window), GLX_BACK_BUFFER_AGE_EXT, &age);
+#endif
+    return age;
+  }
+}
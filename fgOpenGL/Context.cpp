@@ -18,8 +18,7 @@ namespace GL {
   __KHASH_IMPL(tex, , const Asset*, GLuint, 1, kh_ptr_hash_func, kh_int_hash_equal);
   __KHASH_IMPL(shader, , const Shader*, GLuint, 1, kh_ptr_hash_func, kh_int_hash_equal);
   __KHASH_IMPL(vao, , ShaderAsset, VAO*, 1, kh_pair_hash_func, kh_int_hash_equal);
-  __KHASH_IMPL(font, , const Font*, uint64_t, 1, kh_ptr_hash_func, kh_int_hash_equal);
-  __KHASH_IMPL(glyph, , uint32_t, char, 0, kh_int_hash_func2, kh_int_hash_equal);
+  __KHASH_IMPL(font, , Font*, FontTexture, 1, kh_ptr_hash_func, kh_int_hash_equal);
 }
 
 using namespace GL;
@@ -53,14 +52,23 @@ const FG_BlendState Context::DEFAULT_BLEND = {
 Context::Context(Backend* backend, FG_MsgReceiver* element, FG_Vec* dim) :
   _backend(backend),
   _element(element),
+  _streambuffer(nullptr),
+  _ubershader(0),
+  _uberobject(nullptr),
   _window(nullptr),
   _buffercount(0),
-  _bufferoffset(0),
+  _textfont(nullptr),
+  _textpage(-1),
+  _textpower(0),
+  _textblur(0),
   _texhash(kh_init_tex()),
   _fonthash(kh_init_font()),
-  _glyphhash(kh_init_glyph()),
   _vaohash(kh_init_vao()),
   _shaderhash(kh_init_shader()),
+  _uniformhash(kh_init_uniform()),
+  _instancekind(SHAPE_RECT),
+  _caps(0),
+  _targets(this),
   _initialized(false),
   _clipped(false),
   _lastblend({
@@ -73,6 +81,8 @@ Context::Context(Backend* backend, FG_MsgReceiver* element, FG_Vec* dim) :
     0b1111,
   })
 {
+  InvalidateState();
+  memset(&_stats, 0, sizeof(_stats));
   if(dim)
     SetDim(*dim);
 }
@@ -82,13 +92,17 @@ Context::~Context()
     DestroyResources();
   kh_destroy_tex(_texhash);
   kh_destroy_font(_fonthash);
-  kh_destroy_glyph(_glyphhash);
   kh_destroy_vao(_vaohash);
   kh_destroy_shader(_shaderhash);
+  kh_destroy_uniform(_uniformhash);
 }
 
 void Context::BeginDraw(const FG_Rect* area)
 {
+  // Whoever had the context before us could have changed anything
+  InvalidateState();
+  memset(&_stats, 0, sizeof(_stats));
+
   if(_window)
   {
     glfwMakeContextCurrent(_window);
@@ -117,8 +131,20 @@ void Context::BeginDraw(const FG_Rect* area)
     glGetIntegerv(GL_BLEND_SRC_ALPHA, &_statestore.alphasrc);
     glGetIntegerv(GL_BLEND_DST_ALPHA, &_statestore.alphadest);
     glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &_statestore.alphaop);
+
+    glGetBooleanv(GL_SCISSOR_TEST, &_statestore.scissortest);
+    glGetIntegerv(GL_SCISSOR_BOX, _statestore.scissor);
+    glGetIntegerv(GL_VIEWPORT, _statestore.viewport);
+    memcpy(_bound.viewport, _statestore.viewport, sizeof(_bound.viewport)); // Clip rects are flipped against it
+    glGetIntegerv(GL_CURRENT_PROGRAM, &_statestore.program);
+#ifndef USE_EMULATED_VAOS
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &_statestore.vao);
+#endif
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &_statestore.arraybuffer);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &_statestore.activetexture);
+    _statestore.savedunits = 0;
   }
-  
+
   SetDefaultState();
   _clipped = area != nullptr;
   if(_clipped)
@@ -129,8 +155,23 @@ void Context::EndDraw()
   if(_clipped)
     PopClip();
   _clipped = false;
+  _streambuffer->Fence();
+  _targets.Trim();
+  if(_backend->_logstats) // Otherwise this would be a log call on every frame
+  {
+    const DrawStats& stats = GetStats();
+    (*_backend->_log)(_backend->_root, FG_Level_DEBUG,
+                      "Frame drew %u text commands (%u merged), sent %u binding changes and skipped %u", stats.textdraws,
+                      stats.textmerged, stats.statechanges, stats.stateskipped);
+  }
   if(_window)
+  {
+#ifdef USE_EMULATED_VAOS
+    // Emulated VAOs leave their attributes enabled until they're unbound
+    BindVAO(nullptr);
+#endif
     glfwSwapBuffers(_window);
+  }
   else
   {
     // Restore saved OpenGL state
@@ -158,6 +199,35 @@ void Context::EndDraw()
     _backend->LogError("glBlendFuncSeparate");
     glBlendEquationSeparate(_statestore.colorop, _statestore.alphaop);
     _backend->LogError("glBlendEquationSeparate");
+
+#ifdef USE_EMULATED_VAOS
+    BindVAO(nullptr);
+#else
+    glBindVertexArray(_statestore.vao);
+    _backend->LogError("glBindVertexArray");
+#endif
+    glBindBuffer(GL_ARRAY_BUFFER, _statestore.arraybuffer);
+    _backend->LogError("glBindBuffer");
+    glUseProgram(_statestore.program);
+    _backend->LogError("glUseProgram");
+    for(GLuint i = 0; i < MAX_TEXTURE_UNITS; ++i)
+    {
+      if(_statestore.savedunits & (1u << i))
+      {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, _statestore.textures[i]);
+        _backend->LogError("glBindTexture");
+      }
+    }
+    glActiveTexture(_statestore.activetexture);
+    _backend->LogError("glActiveTexture");
+    FlipFlag(1, _statestore.scissortest, 1, GL_SCISSOR_TEST);
+    _backend->LogError("glEnable");
+    glScissor(_statestore.scissor[0], _statestore.scissor[1], _statestore.scissor[2], _statestore.scissor[3]);
+    _backend->LogError("glScissor");
+    glViewport(_statestore.viewport[0], _statestore.viewport[1], _statestore.viewport[2], _statestore.viewport[3]);
+    _backend->LogError("glViewport");
+    InvalidateState();
   }
 }
 
@@ -205,21 +275,18 @@ FG_Err Context::DrawTextureQuad(GLuint tex, ImageVertex* v, FG_Color color, mat4
   for(int i = 0; i < 4; ++i)
     ColorFloats(color, v[i].color, linearize);
 
-  glUseProgram(_imageshader);
-  _backend->LogError("glUseProgram");
-  _imageobject->Bind();
+  UseProgram(_imageshader);
+  BindVAO(_imageobject);
 
-  glBindBuffer(GL_ARRAY_BUFFER, _imagebuffer);
-  _backend->LogError("glBindBuffer");
   AppendBatch(v, sizeof(ImageVertex) * 4, 4);
-  Shader::SetUniform(_backend, _imageshader, "MVP", GL_FLOAT_MAT4, (float*)transform);
-  Shader::SetUniform(_backend, _imageshader, 0, GL_TEXTURE0, (float*)&tex);
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, FlushBatch());
+  Shader::SetUniform(this, GetUniform(_imageshader, UNIFORM_MVP), GL_FLOAT_MAT4, (float*)transform);
+  Shader::SetUniform(this, -1, GL_TEXTURE0, (float*)&tex);
+  GLint first;
+  GLsizei count = FlushBatch(sizeof(ImageVertex), first);
+  glDrawArrays(GL_TRIANGLE_STRIP, first, count);
   _backend->LogError("glDrawArrays");
-  glBindVertexArray(0);
-  _backend->LogError("glBindVertexArray");
 
-  return glGetError();
+  return ERR_SUCCESS;
 }
 
 FG_Err Context::DrawTextGL(FG_Font* fgfont, void* textlayout, FG_Rect* area, FG_Color color, float blur, float rotate,
@@ -227,70 +294,107 @@ FG_Err Context::DrawTextGL(FG_Font* fgfont, void* textlayout, FG_Rect* area, FG_
 {
   auto font   = static_cast<Font*>(fgfont);
   auto layout = reinterpret_cast<TextLayout*>(textlayout);
+  font->Collect(); // Place anything the glyph workers finished since the last draw
 
-  glUseProgram(_imageshader);
-  _backend->LogError("glUseProgram");
-  _imageobject->Bind();
+  // Text commands are queued up, and consecutive ones that share an atlas and MVP are merged into one draw call, as
+  // long as their glyphs stay on the same atlas page. Rotation can differ between merged commands, so it is applied to
+  // each vertex instead of the MVP.
+  mat4x4 mv;
+  mat4x4& mvp = GetRotationMatrix(mv, 0.0f, z, GetProjection());
 
-  glBindBuffer(GL_ARRAY_BUFFER, _imagebuffer);
-  _backend->LogError("glBindBuffer");
+  ++_stats.textdraws;
+  if(_buffercount > 0 && _textfont == font->GetAtlas() && !memcmp(_textmvp, mvp, sizeof(mat4x4)) &&
+     (!font->IsSDF() || _textblur == blur))
+    ++_stats.textmerged;
+  else
+  {
+    FlushText();
+    _textfont = font->GetAtlas();
+    _textpage = -1;
+    _textblur = blur;
+    mat4x4_dup(_textmvp, mvp);
+  }
 
-  mat4x4 mv;
-  Shader::SetUniform(_backend, _imageshader, "MVP", GL_FLOAT_MAT4, (float*)GetRotationMatrix(mv, rotate, z, GetProjection()));
+  // The MVP rotates in clip space, so the equivalent transform in pixel space is proj^-1 * R * proj
+  mat4x4 transform;
+  if(rotate != 0.0f)
+  {
+    mat4x4 inv;
+    mat4x4_invert(inv, GetProjection());
+    mat4x4_identity(mv);
+    mat4x4_rotate_Z(mv, mv, rotate);
+    mat4x4_mul(mv, mv, GetProjection());
+    mat4x4_mul(transform, inv, mv);
+  }
+
+  float colors[4];
+  ColorFloats(color, colors, linearize);
 
-  float dim  = (float)(1 << font->GetSizePower());
   FG_Vec pen = { area->left, area->top + ((layout->lineheight / font->lineheight) * font->GetAscender()) };
   FG_Rect rect;
   ImageVertex v[4];
 
-  for(int i = 0; i < layout->n_lines;)
+  for(auto& run : layout->runs)
   {
-    const char32_t* pos  = layout->lines[i];
-    const char32_t* next = 0;
-    if(++i != layout->n_lines)
-      next = layout->lines[i];
+    pen.y = ceilf(pen.y); // Always pixel snap the baseline.
+    pen.x = area->left;
 
-    pen.y      = ceilf(pen.y); // Always pixel snap the baseline.
-    pen.x      = area->left;
-    char32_t c = 0;
-
-    while(*pos && pos != next)
+    // Kerning and any other positioning was already applied when the line was shaped
+    for(auto& shaped : run->glyphs)
     {
-      char32_t last = c;
-      c             = *pos;
-      auto g        = font->RenderGlyph(this, c);
-      if(!g)
+      auto gfont = shaped.font; // Differs from font for glyphs taken from a fallback, which have their own atlas
+      auto g     = gfont->LoadGlyph(shaped.index);
+      if(g && g->page >= 0) // Glyphs without any pixels, like spaces, only move the pen
       {
-        ++pos;
-        continue;
-      }
-
-      // We add the kerning amount to the pen position for this character pair first, before doing anything else.
-      pen.x += font->GetKerning(last, c);
-      ++pos;
+        if(g->page != _textpage || gfont->GetAtlas() != _textfont)
+        {
+          FlushText();
+          _textfont  = gfont->GetAtlas();
+          _textpage  = g->page;
+          _textpower = gfont->GetPagePower(g->page);
+        }
+        else if(_textpower != gfont->GetPagePower(g->page))
+        {
+          // The page grew, but every glyph kept its pixel position, so the UVs of pending glyphs just need rescaling
+          const float scale = 1.0f / (1 << (gfont->GetPagePower(g->page) - _textpower));
+          auto pending      = reinterpret_cast<ImageVertex*>(_batch.data());
+          for(size_t k = 0; k < _batch.size() / sizeof(ImageVertex); ++k)
+          {
+            pending[k].posUV[2] *= scale;
+            pending[k].posUV[3] *= scale;
+          }
+          _textpower = gfont->GetPagePower(g->page);
+        }
 
-      rect.left   = pen.x + g->bearing.x;
-      rect.top    = pen.y - g->bearing.y;
-      rect.right  = rect.left + g->width;
-      rect.bottom = rect.top + g->height;
+        rect = gfont->GetBounds(*g, FG_Vec{ pen.x + shaped.offset.x, pen.y + shaped.offset.y });
 
-      _buildPosUV(v, rect, g->uv, dim, dim);
+        const float dim = static_cast<float>(1 << _textpower);
+        _buildPosUV(v, rect, g->uv, dim, dim);
 
-      for(int k = 0; k < 4; ++k)
-        ColorFloats(color, v[k].color, linearize);
+        for(int k = 0; k < 4; ++k)
+        {
+          memcpy(v[k].color, colors, sizeof(colors));
+          if(rotate != 0.0f)
+          {
+            vec4 p = { v[k].posUV[0], v[k].posUV[1], 0.0f, 1.0f };
+            vec4 r;
+            mat4x4_mul_vec4(r, transform, p);
+            v[k].posUV[0] = r[0];
+            v[k].posUV[1] = r[1];
+          }
+        }
 
-      if(CheckFlush(sizeof(v)))
-        _flushbatchdraw(font);
-      AppendBatch(v, sizeof(v), 1);
+        if(CheckFlush(sizeof(v)))
+          FlushText();
+        AppendBatch(v, sizeof(v), 1);
+      }
 
-      pen.x += g->advance + layout->letterspacing;
+      pen.x += shaped.advance + layout->letterspacing;
     }
     pen.y += layout->lineheight;
   }
 
-  _flushbatchdraw(font);
-
-  return glGetError();
+  return ERR_SUCCESS;
 }
 
 FG_Err Context::DrawAsset(FG_Asset* asset, FG_Rect* area, FG_Rect* source, FG_Color color, float time, float rotate,
@@ -339,74 +443,103 @@ void Context::GenTransform(mat4x4 target, const FG_Rect& area, float rotate, flo
   target[3][2] = z;
 }
 
-void Context::_drawStandard(GLuint shader, VAO* vao, mat4x4 proj, const FG_Rect& area, const FG_Rect& corners,
+void Context::_drawStandard(GLuint shader, ShapeKind kind, mat4x4 proj, const FG_Rect& area, const FG_Rect& corners,
                             FG_Color fillColor, float border, FG_Color borderColor, float blur, float rotate, float z,
                             bool linearize)
 {
-  mat4x4 mvp;
-  GenTransform(mvp, area, rotate, z);
-  mat4x4_mul(mvp, proj, mvp);
-
-  float dimdata[4];
-  dimdata[0] = area.right - area.left;
-  dimdata[1] = area.bottom - area.top;
-  dimdata[2] = border;
-  dimdata[3] = blur;
-
-  float fill[4];
-  ColorFloats(fillColor, fill, linearize);
-  float outline[4];
-  ColorFloats(borderColor, outline, linearize);
+  ShapeInstance shape;
+  GenTransform(shape.mvp, area, rotate, z);
+  mat4x4_mul(shape.mvp, proj, shape.mvp);
+
+  shape.dimBorderBlur[0] = area.right - area.left;
+  shape.dimBorderBlur[1] = area.bottom - area.top;
+  shape.dimBorderBlur[2] = border;
+  shape.dimBorderBlur[3] = blur;
+
+  memcpy(shape.corners, corners.ltrb, sizeof(shape.corners));
+  ColorFloats(fillColor, shape.fill, linearize);
+  ColorFloats(borderColor, shape.outline, linearize);
   float amount     = blur + ((abs(fmod(rotate, Backend::PI / 2.0f)) <= FLT_EPSILON) ? 0.0f : 1.0f);
-  float inflate[2] = { 1.0f + (amount / dimdata[0]), 1.0f + (amount / dimdata[1]) };
+  shape.inflate[0] = 1.0f + (amount / shape.dimBorderBlur[0]);
+  shape.inflate[1] = 1.0f + (amount / shape.dimBorderBlur[1]);
+  shape.shape      = static_cast<float>(kind);
 
-  glUseProgram(shader);
-  _backend->LogError("glUseProgram");
-  vao->Bind();
+  // If we can, queue the shape so a run of them is drawn with a single instanced call
+  if(HasCap(GLCaps::GLCAP_INSTANCED_ARRAYS))
+  {
+    // The uber shader picks the SDF per instance, so only the per-shape programs have to flush when the kind changes
+    if((!_ubershader && kind != _instancekind) || _instances.size() >= MAX_INSTANCES)
+      FlushShapes();
+    _instancekind = kind;
+    _instances.push_back(shape);
+    return;
+  }
+
+  UseProgram(shader);
+  BindVAO(_quadobject);
 
-  Shader::SetUniform(_backend, shader, "MVP", GL_FLOAT_MAT4, (float*)mvp);
-  Shader::SetUniform(_backend, shader, "DimBorderBlur", GL_FLOAT_VEC4, dimdata);
-  Shader::SetUniform(_backend, shader, "Corners", GL_FLOAT_VEC4, (float*)corners.ltrb);
-  Shader::SetUniform(_backend, shader, "Fill", GL_FLOAT_VEC4, fill);
-  Shader::SetUniform(_backend, shader, "Outline", GL_FLOAT_VEC4, outline);
-  Shader::SetUniform(_backend, shader, "Inflate", GL_FLOAT_VEC2, inflate);
+  Shader::SetUniform(this, GetUniform(shader, UNIFORM_MVP), GL_FLOAT_MAT4, (float*)shape.mvp);
+  Shader::SetUniform(this, GetUniform(shader, UNIFORM_DIMBORDERBLUR), GL_FLOAT_VEC4, shape.dimBorderBlur);
+  Shader::SetUniform(this, GetUniform(shader, UNIFORM_CORNERS), GL_FLOAT_VEC4, shape.corners);
+  Shader::SetUniform(this, GetUniform(shader, UNIFORM_FILL), GL_FLOAT_VEC4, shape.fill);
+  Shader::SetUniform(this, GetUniform(shader, UNIFORM_OUTLINE), GL_FLOAT_VEC4, shape.outline);
+  Shader::SetUniform(this, GetUniform(shader, UNIFORM_INFLATE), GL_FLOAT_VEC2, shape.inflate);
 
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
   _backend->LogError("glDrawArrays");
-  vao->Unbind();
+}
+
+void Context::FlushShapes()
+{
+  if(_instances.empty())
+    return;
+
+  UseProgram(!_ubershader ? _instancedshaders[_instancekind] : _ubershader);
+  BindVAO(!_ubershader ? _instancedobjects[_instancekind] : _uberobject);
+
+  // Orphan the previous contents so we never wait on a draw call that is still reading them
+  BindArrayBuffer(_instancebuffer);
+  glBufferData(GL_ARRAY_BUFFER, MAX_INSTANCES * sizeof(ShapeInstance), nullptr, GL_STREAM_DRAW);
+  _backend->LogError("glBufferData");
+  glBufferSubData(GL_ARRAY_BUFFER, 0, _instances.size() * sizeof(ShapeInstance), _instances.data());
+  _backend->LogError("glBufferSubData");
+
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_instances.size()));
+  _backend->LogError("glDrawArraysInstanced");
+  _instances.clear();
 }
 
 FG_Err Context::DrawRect(FG_Rect& area, FG_Rect& corners, FG_Color fillColor, float border, FG_Color borderColor,
                          float blur, FG_Asset* asset, float rotate, float z, bool linearize)
 {
-  _drawStandard(_rectshader, _quadobject, GetProjection(), area, corners, fillColor, border, borderColor, blur, rotate, z,
+  _drawStandard(_rectshader, SHAPE_RECT, GetProjection(), area, corners, fillColor, border, borderColor, blur, rotate, z,
                 linearize);
-  return glGetError();
+  return ERR_SUCCESS;
 }
 
 FG_Err Context::DrawCircle(FG_Rect& area, FG_Color fillColor, float border, FG_Color borderColor, float blur,
                            float innerRadius, float innerBorder, FG_Asset* asset, float z, bool linearize)
 {
-  _drawStandard(_circleshader, _quadobject, GetProjection(), area, FG_Rect{ innerRadius, innerBorder, 0.0f, 0.0f },
+  _drawStandard(_circleshader, SHAPE_CIRCLE, GetProjection(), area, FG_Rect{ innerRadius, innerBorder, 0.0f, 0.0f },
                 fillColor, border, borderColor, blur, 0.0f, z, linearize);
-  return glGetError();
+  return ERR_SUCCESS;
 }
 
 FG_Err Context::DrawArc(FG_Rect& area, FG_Vec angles, FG_Color fillColor, float border, FG_Color borderColor, float blur,
                         float innerRadius, FG_Asset* asset, float z, bool linearize)
 {
-  _drawStandard(_arcshader, _quadobject, GetProjection(), area,
+  _drawStandard(_arcshader, SHAPE_ARC, GetProjection(), area,
                 FG_Rect{ angles.x + (angles.y / 2.0f) - (Backend::PI / 2.0f), angles.y / 2.0f, innerRadius, 0.0f },
                 fillColor, border, borderColor, blur, 0.0f, z, linearize);
-  return glGetError();
+  return ERR_SUCCESS;
 }
 
 FG_Err Context::DrawTriangle(FG_Rect& area, FG_Rect& corners, FG_Color fillColor, float border, FG_Color borderColor,
                              float blur, FG_Asset* asset, float rotate, float z, bool linearize)
 {
-  _drawStandard(_trishader, _quadobject, GetProjection(), area, corners, fillColor, border, borderColor, blur, rotate, z,
+  _drawStandard(_trishader, SHAPE_TRIANGLE, GetProjection(), area, corners, fillColor, border, borderColor, blur, rotate, z,
                 linearize);
-  return glGetError();
+  return ERR_SUCCESS;
 }
 
 FG_Err Context::DrawLines(FG_Vec* points, uint32_t count, FG_Color color, bool linearize)
@@ -414,22 +547,27 @@ FG_Err Context::DrawLines(FG_Vec* points, uint32_t count, FG_Color color, bool l
   float colors[4];
   ColorFloats(color, colors, linearize);
 
-  glUseProgram(_lineshader);
-  _backend->LogError("glUseProgram");
-  _lineobject->Bind();
+  FlushText(); // The batch has to be empty so each piece of the strip fits
+  UseProgram(_lineshader);
+  BindVAO(_lineobject);
 
-  glBindBuffer(GL_ARRAY_BUFFER, _linebuffer);
-  _backend->LogError("glBindBuffer");
+  Shader::SetUniform(this, GetUniform(_lineshader, UNIFORM_MVP), GL_FLOAT_MAT4, (float*)GetProjection());
+  Shader::SetUniform(this, GetUniform(_lineshader, UNIFORM_COLOR), GL_FLOAT_VEC4, colors);
 
-  AppendBatch(points, sizeof(FG_Vec) * count, count);
-  Shader::SetUniform(_backend, _lineshader, "MVP", GL_FLOAT_MAT4, (float*)GetProjection());
-  Shader::SetUniform(_backend, _lineshader, "Color", GL_FLOAT_VEC4, colors);
+  // A strip too long for one batch is drawn in pieces that share their end points, so it stays connected
+  const uint32_t max = static_cast<uint32_t>(BATCH_BYTES / sizeof(FG_Vec));
+  for(uint32_t i = 0; i == 0 || i + 1 < count; i += max - 1)
+  {
+    uint32_t n = std::min(count - i, max);
+    AppendBatch(points + i, sizeof(FG_Vec) * n, n);
 
-  glDrawArrays(GL_LINE_STRIP, 0, FlushBatch());
-  _backend->LogError("glDrawArrays");
-  _lineobject->Unbind();
+    GLint first;
+    GLsizei drawn = FlushBatch(sizeof(FG_Vec), first);
+    glDrawArrays(GL_LINE_STRIP, first, drawn);
+    _backend->LogError("glDrawArrays");
+  }
 
-  return glGetError();
+  return ERR_SUCCESS;
 }
 
 FG_Err Context::DrawCurve(FG_Vec* anchors, uint32_t count, FG_Color fillColor, float stroke, FG_Color strokeColor,
@@ -448,28 +586,28 @@ FG_Err Context::DrawShader(FG_Shader* fgshader, FG_Asset* vertices, FG_Asset* in
   auto shader   = static_cast<Shader*>(fgshader);
   auto instance = LoadShader(shader);
 
-  glUseProgram(instance);
-  _backend->LogError("glUseProgram");
-  LoadVAO(shader, static_cast<Asset*>(vertices))->Bind();
+  UseProgram(instance);
+  BindVAO(LoadVAO(shader, static_cast<Asset*>(vertices)));
 
   for(uint32_t i = 0; i < shader->n_parameters; ++i)
   {
     auto type = Shader::GetType(shader->parameters[i]);
+    auto loc  = GetUniform(instance, i);
     switch(type)
     {
     case GL_DOUBLE:
     case GL_HALF_FLOAT: // we assume you pass in a proper float to fill this
     case GL_FLOAT:
     case GL_INT:
-    case GL_UNSIGNED_INT: Shader::SetUniform(_backend, instance, shader->parameters[i].name, type, &values[i].f32); break;
+    case GL_UNSIGNED_INT: Shader::SetUniform(this, loc, type, &values[i].f32); break;
     default:
       if(type >= GL_TEXTURE0 && type <= GL_TEXTURE31)
       {
         GLuint idx = LoadAsset(static_cast<Asset*>(values[i].asset));
-        Shader::SetUniform(_backend, instance, shader->parameters[i].name, type, (float*)&idx);
+        Shader::SetUniform(this, loc, type, (float*)&idx);
       }
       else
-        Shader::SetUniform(_backend, instance, shader->parameters[i].name, type, values[i].pf32);
+        Shader::SetUniform(this, loc, type, values[i].pf32);
       break;
     }
   }
@@ -503,7 +641,6 @@ FG_Err Context::DrawShader(FG_Shader* fgshader, FG_Asset* vertices, FG_Asset* in
     _backend->LogError("glDrawElements");
   }
 
-  glBindVertexArray(0);
   return -1;
 }
 
@@ -527,30 +664,171 @@ void Context::PushClip(const FG_Rect& rect)
 }
 
 // Should only be used when mapping floats to a scissor rect. Otherwise the precise integer version should be used.
-void Context::Scissor(const FG_Rect& rect, float x, float y) const
+void Context::Scissor(const FG_Rect& rect, float x, float y)
 {
   int l = static_cast<int>(floorf(rect.left - x));
   int t = static_cast<int>(floorf(rect.top - y));
   int r = static_cast<int>(ceilf(rect.right - x));
   int b = static_cast<int>(ceilf(rect.bottom - y));
-  glScissor(l, t, r - l, b - t);
+
+  // glScissor counts rows up from the bottom, but our projections put y = 0 at the top, so flip against the viewport
+  // that's being drawn to. This has to be set before any clip rects are pushed.
+  GLint box[4] = { _bound.viewport[0] + l, _bound.viewport[1] + _bound.viewport[3] - b, r - l, b - t };
+  if(!memcmp(_bound.scissor, box, sizeof(box)))
+  {
+    ++_stats.stateskipped;
+    return;
+  }
+
+  ++_stats.statechanges;
+  memcpy(_bound.scissor, box, sizeof(box));
+  glScissor(box[0], box[1], box[2], box[3]);
   _backend->LogError("glScissor");
 }
 
-void Context::StandardViewport() const
+void Context::StandardViewport()
 {
+  if(!_window) // We don't own the context, so restore whatever viewport the caller was using
+  {
+    ++_stats.statechanges;
+    memcpy(_bound.viewport, _statestore.viewport, sizeof(_bound.viewport));
+    glViewport(_statestore.viewport[0], _statestore.viewport[1], _statestore.viewport[2], _statestore.viewport[3]);
+    _backend->LogError("glViewport");
+    return;
+  }
+
   GLsizei w;
   GLsizei h;
   glfwGetFramebufferSize(_window, &w, &h);
-  glViewport(0, 0, w, h);
-  _backend->LogError("glViewport");
+  Viewport(w, h);
 }
-void Context::Viewport(GLsizei w, GLsizei h) const
+void Context::Viewport(GLsizei w, GLsizei h)
 {
+  if(!_bound.viewport[0] && !_bound.viewport[1] && _bound.viewport[2] == w && _bound.viewport[3] == h)
+  {
+    ++_stats.stateskipped;
+    return;
+  }
+
+  ++_stats.statechanges;
+  _bound.viewport[0] = 0;
+  _bound.viewport[1] = 0;
+  _bound.viewport[2] = w;
+  _bound.viewport[3] = h;
   glViewport(0, 0, w, h);
   _backend->LogError("glViewport");
 }
 
+void Context::UseProgram(GLuint program)
+{
+  if(_bound.program == program)
+  {
+    ++_stats.stateskipped;
+    return;
+  }
+
+  ++_stats.statechanges;
+  _bound.program = program;
+  glUseProgram(program);
+  _backend->LogError("glUseProgram");
+}
+
+void Context::BindVAO(VAO* vao)
+{
+  if(_bound.vaoknown && _bound.vao == vao)
+  {
+    ++_stats.stateskipped;
+    return;
+  }
+
+  ++_stats.statechanges;
+#ifdef USE_EMULATED_VAOS
+  // An emulated VAO is a set of enabled attributes, so the previous set has to be disabled first. Binding one also
+  // changes the array buffer.
+  if(_bound.vaoknown && _bound.vao)
+    _bound.vao->Unbind();
+  _bound.arraybuffer = UNKNOWN_BINDING;
+  if(vao)
+    vao->Bind();
+#else
+  if(vao)
+    vao->Bind();
+  else
+  {
+    glBindVertexArray(0);
+    _backend->LogError("glBindVertexArray");
+  }
+#endif
+  _bound.vao      = vao;
+  _bound.vaoknown = true;
+}
+
+void Context::BindArrayBuffer(GLuint buffer)
+{
+  if(_bound.arraybuffer == buffer)
+  {
+    ++_stats.stateskipped;
+    return;
+  }
+
+  ++_stats.statechanges;
+  _bound.arraybuffer = buffer;
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  _backend->LogError("glBindBuffer");
+}
+
+void Context::ActiveTexture(GLuint unit)
+{
+  if(_bound.activeunit == unit)
+  {
+    ++_stats.stateskipped;
+    return;
+  }
+
+  ++_stats.statechanges;
+  _bound.activeunit = unit;
+  glActiveTexture(GL_TEXTURE0 + unit);
+  _backend->LogError("glActiveTexture");
+}
+
+// Only switches the active unit if the texture isn't already bound to it, so code that edits a texture through the
+// active unit has to call ActiveTexture() itself.
+void Context::BindTexture(GLuint unit, GLuint texture)
+{
+  if(_bound.textures[unit] == texture)
+  {
+    ++_stats.stateskipped;
+    return;
+  }
+
+  ActiveTexture(unit);
+
+  // Region contexts hand back the host's texture bindings in EndDraw, but only for the units we actually touched
+  if(!_window && !(_statestore.savedunits & (1u << unit)))
+  {
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &_statestore.textures[unit]);
+    _statestore.savedunits |= (1u << unit);
+  }
+
+  ++_stats.statechanges;
+  _bound.textures[unit] = texture;
+  glBindTexture(GL_TEXTURE_2D, texture);
+  _backend->LogError("glBindTexture");
+}
+
+void Context::InvalidateState()
+{
+  _bound.program     = UNKNOWN_BINDING;
+  _bound.vao         = nullptr;
+  _bound.vaoknown    = false;
+  _bound.arraybuffer = UNKNOWN_BINDING;
+  _bound.activeunit  = UNKNOWN_BINDING;
+  for(auto& t : _bound.textures)
+    t = UNKNOWN_BINDING;
+  _bound.scissor[2]  = -1;
+  _bound.viewport[2] = -1;
+}
+
 void Context::PopClip()
 {
   _clipstack.pop_back();
@@ -576,27 +854,59 @@ int Context::PushLayer(Layer* layer, float* transform, float opacity, FG_BlendSt
   layer->Update(transform, opacity, blend, this);
   _layers.push_back(layer);
 
-  glBindFramebuffer(GL_FRAMEBUFFER, layer->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, layer->target.framebuffer);
   _backend->LogError("glBindFramebuffer");
 
   _backend->LogError("glEnable");
-  Viewport(layer->size.x, layer->size.y);
+  Viewport(layer->size.x, layer->size.y); // Clip rects flip against this, not the pooled target, which may be taller
+
+  // The clip stack is in the coordinates of whatever is being drawn to, so the layer gets a stack of its own. A valid
+  // cached layer only redraws its dirty area. If nothing is dirty the clip is empty, so a caller that ignores the
+  // CACHED result and draws anyway still leaves the retained contents untouched.
+  const bool cached = (layer->flags & FG_AssetFlags_CACHE_LAYER) && layer->valid;
+  layer->redraw     = cached ? layer->dirty :
+                               FG_Rect{ 0, 0, static_cast<float>(layer->size.x), static_cast<float>(layer->size.y) };
+  layer->dirty      = FG_Rect{ 0, 0, 0, 0 };
+  if(layer->flags & FG_AssetFlags_CACHE_LAYER)
+    layer->valid = true; // Once this draw finishes. Anything invalidated while drawing is kept for the next one.
+  layer->outerclip.swap(_clipstack);
+  _clipstack.clear();
+  PushClip(layer->redraw);
+
+  if(cached && (layer->redraw.right <= layer->redraw.left || layer->redraw.bottom <= layer->redraw.top))
+    return Layer::CACHED;
   return 0;
 }
 
 void Context::AppendBatch(const void* vertices, GLsizeiptr bytes, GLsizei count)
 {
-  glBufferSubData(GL_ARRAY_BUFFER, _bufferoffset, bytes, vertices);
-  _backend->LogError("glBufferSubData");
-  _bufferoffset += bytes;
+  auto p = reinterpret_cast<const uint8_t*>(vertices);
+  _batch.insert(_batch.end(), p, p + bytes);
   _buffercount += count;
 }
 
-GLsizei Context::FlushBatch()
+GLsizei Context::FlushBatch(GLsizeiptr stride, GLint& first, bool rewind)
 {
-  GLsizei count = _buffercount;
-  _bufferoffset = 0;
-  _buffercount  = 0;
+  GLsizei count   = _buffercount;
+  GLintptr offset = 0;
+  if(!_batch.empty())
+  {
+    BindArrayBuffer(_streambuffer->GetBuffer());
+    offset = _streambuffer->Write(_batch.data(), _batch.size(), stride, rewind);
+  }
+  _buffercount = 0;
+  first        = 0;
+
+  if(offset < 0)
+  {
+    (*_backend->_log)(_backend->_root, FG_Level_ERROR, "A batch of %zu bytes doesn't fit in the stream buffer!",
+                      _batch.size());
+    _batch.clear();
+    return 0;
+  }
+
+  _batch.clear();
+  first = static_cast<GLint>(offset / stride);
   return count;
 }
 
@@ -604,7 +914,9 @@ int Context::PopLayer()
 {
   Layer* p = _layers.back();
   _layers.pop_back();
-  glBindFramebuffer(GL_FRAMEBUFFER, !_layers.size() ? 0 : _layers.back()->framebuffer);
+  PopClip();
+
+  glBindFramebuffer(GL_FRAMEBUFFER, !_layers.size() ? 0 : _layers.back()->target.framebuffer);
   _backend->LogError("glBindFramebuffer");
 
   if(_layers.size() > 0)
@@ -612,6 +924,15 @@ int Context::PopLayer()
   else
     StandardViewport();
 
+  // The outer clip rects are flipped against the outer viewport, so they can only be restored once it's back
+  _clipstack.swap(p->outerclip);
+  p->outerclip.clear();
+  if(!_clipstack.empty())
+  {
+    glEnable(GL_SCISSOR_TEST);
+    Scissor(_clipstack.back(), 0, 0);
+  }
+
   return p->Composite();
 }
 
@@ -638,12 +959,9 @@ GLuint Context::_createBuffer(size_t stride, size_t count, const void* init)
   GLuint buffer;
   glGenBuffers(1, &buffer);
   _backend->LogError("glGenBuffers");
-  glBindBuffer(GL_ARRAY_BUFFER, buffer);
-  _backend->LogError("glBindBuffer");
+  BindArrayBuffer(buffer);
   glBufferData(GL_ARRAY_BUFFER, stride * count, init, !init ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
   _backend->LogError("glBufferData");
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  _backend->LogError("glBindBuffer");
   return buffer;
 }
 
@@ -652,6 +970,7 @@ GLuint Context::_genIndices(size_t num)
   GLuint indices;
   glGenBuffers(1, &indices);
   _backend->LogError("glGenBuffers");
+  BindVAO(nullptr); // The element buffer binding belongs to the VAO
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
   _backend->LogError("glBindBuffer");
   std::unique_ptr<GLuint[]> buf(new GLuint[num]);
@@ -692,12 +1011,36 @@ void Context::CreateResources()
 {
   SetDefaultState();
 
-  _imageshader  = _backend->_imageshader.Create(_backend);
-  _rectshader   = _backend->_rectshader.Create(_backend);
-  _circleshader = _backend->_circleshader.Create(_backend);
-  _arcshader    = _backend->_arcshader.Create(_backend);
-  _trishader    = _backend->_trishader.Create(_backend);
-  _lineshader   = _backend->_trishader.Create(_backend);
+  // Report errors through KHR_debug if asked to, falling back to polling glGetError if it isn't available
+  if(_backend->_debugcallback)
+  {
+    if(GLAD_GL_KHR_debug)
+    {
+      glEnable(GL_DEBUG_OUTPUT);
+      glDebugMessageCallback(&Backend::DebugCallback, _backend);
+    }
+    else
+    {
+      (*_backend->_log)(_backend->_root, FG_Level_WARNING, "KHR_debug isn't supported, FEATHER_GL_DEBUG is ignored.");
+      _backend->_debugcallback = false;
+    }
+  }
+
+  _caps = 0;
+  if(GLAD_GL_VERSION_3_1)
+    _caps |= static_cast<int>(GLCaps::GLCAP_INSTANCES);
+  if(GLAD_GL_VERSION_3_2)
+    _caps |= static_cast<int>(GLCaps::GLCAP_SYNC) | static_cast<int>(GLCaps::GLCAP_BASE_VERTEX);
+  if(GLAD_GL_VERSION_3_3)
+    _caps |= static_cast<int>(GLCaps::GLCAP_INSTANCED_ARRAYS) | static_cast<int>(GLCaps::GLCAP_SWIZZLE);
+
+  _imageshader  = _backend->_imageshader.Create(_backend, _uniformhash);
+  _sdfshader    = _backend->_sdfshader.Create(_backend, _uniformhash);
+  _rectshader   = _backend->_rectshader.Create(_backend, _uniformhash);
+  _circleshader = _backend->_circleshader.Create(_backend, _uniformhash);
+  _arcshader    = _backend->_arcshader.Create(_backend, _uniformhash);
+  _trishader    = _backend->_trishader.Create(_backend, _uniformhash);
+  _lineshader   = _backend->_lineshader.Create(_backend, _uniformhash);
 
   QuadVertex rect[4] = {
     { 0, 0 },
@@ -712,16 +1055,51 @@ void Context::CreateResources()
   _quadbuffer = _createBuffer(sizeof(QuadVertex), 4, rect);
   _quadobject = new VAO(_backend, _rectshader, rectparams, 1, _quadbuffer, sizeof(QuadVertex), 0);
 
-  _imagebuffer  = _createBuffer(sizeof(ImageVertex), BATCH_BYTES / sizeof(ImageVertex), nullptr);
-  _imageindices = _genIndices(BATCH_BYTES / sizeof(GLuint));
-  _imageobject  = new VAO(_backend, _imageshader, imgparams, 2, _imagebuffer, sizeof(ImageVertex), _imageindices);
+  // Without fences the stream buffer is orphaned whenever it wraps, and without base vertices text always starts at 0
+  _streambuffer = new StreamBuffer(_backend, STREAM_BYTES, HasCap(GLCaps::GLCAP_SYNC));
+  _batch.reserve(BATCH_BYTES);
+  _imageindices = _genIndices(MAX_INDICES);
+  _imageobject  = new VAO(_backend, _imageshader, imgparams, 2, _streambuffer->GetBuffer(), sizeof(ImageVertex),
+                         _imageindices);
+  _sdfobject    = new VAO(_backend, _sdfshader, imgparams, 2, _streambuffer->GetBuffer(), sizeof(ImageVertex),
+                         _imageindices);
+  _lineobject   = new VAO(_backend, _lineshader, rectparams, 1, _streambuffer->GetBuffer(), sizeof(FG_Vec), 0);
+
+  // Instanced SDF shapes need both glDrawArraysInstanced and glVertexAttribDivisor, which are core in 3.3
+  if(HasCap(GLCaps::GLCAP_INSTANCED_ARRAYS))
+  {
+    FG_ShaderParameter instparams[7] = {
+      { FG_ShaderType_FLOAT, 4, 4, "vMVP" },     { FG_ShaderType_FLOAT, 4, 1, "vDimBorderBlur" },
+      { FG_ShaderType_FLOAT, 4, 1, "vCorners" }, { FG_ShaderType_FLOAT, 4, 1, "vFill" },
+      { FG_ShaderType_FLOAT, 4, 1, "vOutline" }, { FG_ShaderType_FLOAT, 2, 1, "vInflate" },
+      { FG_ShaderType_FLOAT, 1, 1, "vShape" },
+    };
+
+    _instancebuffer = _createBuffer(sizeof(ShapeInstance), MAX_INSTANCES, nullptr);
+    for(int i = 0; i < SHAPE_COUNT; ++i)
+    {
+      _instancedshaders[i] = _backend->_instancedshaders[i].Create(_backend, _uniformhash);
+      _instancedobjects[i] = new VAO(_backend, _instancedshaders[i], rectparams, 1, _quadbuffer, sizeof(QuadVertex), 0,
+                                     instparams, 7, _instancebuffer, sizeof(ShapeInstance));
+    }
 
-  _linebuffer = _createBuffer(sizeof(FG_Vec), BATCH_BYTES / sizeof(FG_Vec), nullptr);
-  _lineobject = new VAO(_backend, _lineshader, rectparams, 1, _linebuffer, sizeof(FG_Vec), 0);
+    _ubershader = 0;
+    _uberobject = nullptr;
+    if(_backend->_uberenabled)
+    {
+      _ubershader = _backend->_ubershader.Create(_backend, _uniformhash);
+      _uberobject = new VAO(_backend, _ubershader, rectparams, 1, _quadbuffer, sizeof(QuadVertex), 0, instparams, 7,
+                            _instancebuffer, sizeof(ShapeInstance));
+    }
+    _instances.reserve(MAX_INSTANCES);
+    _backend->features = static_cast<FG_Feature>(_backend->features | FG_Feature_BATCHING);
+  }
 
   for(auto& l : _layers)
     l->Create();
 
+  // Creating all of the above binds and unbinds objects behind the cache's back
+  InvalidateState();
   _initialized = true;
 }
 GLuint Context::LoadAsset(Asset* asset)
@@ -744,11 +1122,18 @@ GLuint Context::LoadAsset(Asset* asset)
     case FG_Primitive_INDEX_INT: kind = GL_ELEMENT_ARRAY_BUFFER; break;
     }
 
-    glBindBuffer(kind, idx);
-    _backend->LogError("glBindBuffer");
+    if(kind == GL_ARRAY_BUFFER)
+      BindArrayBuffer(idx);
+    else
+    {
+      BindVAO(nullptr); // The element buffer binding belongs to the VAO
+      glBindBuffer(kind, idx);
+      _backend->LogError("glBindBuffer");
+    }
     glBufferData(kind, asset->stride * asset->count, asset->data.data, GL_STATIC_DRAW);
     _backend->LogError("glBufferData");
-    glBindBuffer(kind, 0);
+    if(kind != GL_ARRAY_BUFFER)
+      glBindBuffer(kind, 0);
   }
   else
   {
@@ -756,8 +1141,11 @@ GLuint Context::LoadAsset(Asset* asset)
     if(!(asset->flags & FG_AssetFlags_NO_MIPMAP))
       flags |= SOIL_FLAG_MIPMAPS;
 
+    // SOIL binds the new texture to whatever unit is active
+    ActiveTexture(0);
     idx = _createTexture((const unsigned char*)asset->data.data, asset->size.x, asset->size.y, asset->channels,
                          SOIL_CREATE_NEW_ID, flags, GL_TEXTURE_2D, GL_TEXTURE_2D, GL_MAX_TEXTURE_SIZE);
+    _bound.textures[0] = UNKNOWN_BINDING;
 
     if(!idx)
     {
@@ -766,14 +1154,11 @@ GLuint Context::LoadAsset(Asset* asset)
       return 0;
     }
 
-    glBindTexture(GL_TEXTURE_2D, idx);
-    _backend->LogError("glBindTexture");
+    BindTexture(0, idx);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     _backend->LogError("glTexParameteri");
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     _backend->LogError("glTexParameteri");
-    glBindTexture(GL_TEXTURE_2D, 0);
-    _backend->LogError("glBindTexture");
   }
 
   int r;
@@ -789,7 +1174,7 @@ GLuint Context::LoadShader(Shader* shader)
   if(iter < kh_end(_shaderhash) && kh_exist(_shaderhash, iter))
     return kh_val(_shaderhash, iter);
 
-  GLuint instance = shader->Create(_backend);
+  GLuint instance = shader->Create(_backend, _uniformhash);
   if(!instance)
     return 0;
 
@@ -801,6 +1186,14 @@ GLuint Context::LoadShader(Shader* shader)
   return instance;
 }
 
+GLint Context::GetUniform(GLuint program, uint32_t index) const
+{
+  khiter_t iter = kh_get_uniform(_uniformhash, Shader::UniformKey(program, index));
+  if(iter < kh_end(_uniformhash) && kh_exist(_uniformhash, iter))
+    return kh_val(_uniformhash, iter);
+  return -1;
+}
+
 VAO* Context::LoadVAO(Shader* shader, Asset* asset)
 {
   GLuint instance = LoadShader(shader);
@@ -814,6 +1207,12 @@ VAO* Context::LoadVAO(Shader* shader, Asset* asset)
     return kh_val(_vaohash, iter);
 
   VAO* object = new VAO(_backend, instance, asset->parameters, asset->n_parameters, buffer, asset->stride, 0);
+#ifndef USE_EMULATED_VAOS
+  // Creating a VAO leaves nothing bound
+  _bound.vao         = nullptr;
+  _bound.vaoknown    = true;
+  _bound.arraybuffer = 0;
+#endif
 
   int r;
   iter = kh_put_vao(_vaohash, pair, &r);
@@ -848,13 +1247,16 @@ void Context::DestroyResources()
   {
     if(kh_exist(_fonthash, i))
     {
-      GLuint idx = static_cast<GLuint>(kh_val(_fonthash, i) & 0xFFFFFFFF);
-      glDeleteTextures(1, &idx);
-      _backend->LogError("glDeleteTextures");
+      for(auto& page : kh_val(_fonthash, i).pages)
+        if(page.texture)
+        {
+          glDeleteTextures(1, &page.texture);
+          _backend->LogError("glDeleteTextures");
+        }
+      kh_key(_fonthash, i)->RemoveContext(this);
     }
   }
   kh_clear_font(_fonthash);
-  kh_clear_glyph(_glyphhash);
 
   for(khiter_t i = 0; i < kh_end(_shaderhash); ++i)
   {
@@ -862,19 +1264,17 @@ void Context::DestroyResources()
       kh_key(_shaderhash, i)->Destroy(_backend, kh_val(_shaderhash, i));
   }
   kh_clear_shader(_shaderhash);
+  kh_clear_uniform(_uniformhash);
 
   for(khiter_t i = 0; i < kh_end(_vaohash); ++i)
   {
     if(kh_exist(_vaohash, i))
-    {
-      GLuint idx = static_cast<GLuint>(kh_val(_fonthash, i) & 0xFFFFFFFF);
-      glDeleteVertexArrays(1, &idx);
-      _backend->LogError("glDeleteVertexArrays");
-    }
+      delete kh_val(_vaohash, i);
   }
   kh_clear_vao(_vaohash);
 
   _backend->_imageshader.Destroy(_backend, _imageshader);
+  _backend->_sdfshader.Destroy(_backend, _sdfshader);
   _backend->_imageshader.Destroy(_backend, _rectshader);
   _backend->_imageshader.Destroy(_backend, _circleshader);
   _backend->_imageshader.Destroy(_backend, _arcshader);
@@ -886,68 +1286,183 @@ void Context::DestroyResources()
   glDeleteBuffers(1, &_quadbuffer);
   _backend->LogError("glDeleteBuffers");
   delete _imageobject;
-  glDeleteBuffers(1, &_imagebuffer);
-  _backend->LogError("glDeleteBuffers");
+  delete _sdfobject;
   glDeleteBuffers(1, &_imageindices);
   _backend->LogError("glDeleteBuffers");
   delete _lineobject;
-  glDeleteBuffers(1, &_linebuffer);
-  _backend->LogError("glDeleteBuffers");
+  delete _streambuffer;
+  _streambuffer = nullptr;
+
+  if(HasCap(GLCaps::GLCAP_INSTANCED_ARRAYS))
+  {
+    _instances.clear();
+    for(int i = 0; i < SHAPE_COUNT; ++i)
+    {
+      _backend->_instancedshaders[i].Destroy(_backend, _instancedshaders[i]);
+      delete _instancedobjects[i];
+    }
+    if(_ubershader)
+    {
+      _backend->_ubershader.Destroy(_backend, _ubershader);
+      delete _uberobject;
+    }
+    glDeleteBuffers(1, &_instancebuffer);
+    _backend->LogError("glDeleteBuffers");
+  }
 
   for(auto& l : _layers)
     l->Destroy();
+  _targets.Clear();
 
+  // Deleted names can be handed out again, so nothing we think is bound can be trusted anymore
+  InvalidateState();
   _initialized = false;
 }
 
-bool Context::CheckGlyph(uint32_t g)
+GLuint Context::SyncFontTexture(Font* font, int page)
 {
-  auto i = kh_get_glyph(_glyphhash, g);
-  return i < kh_end(_glyphhash) && kh_exist(_glyphhash, i);
+  int r;
+  auto i = kh_put_font(_fonthash, font, &r);
+  if(r < 0)
+    return 0;
+  if(r > 0)
+  {
+    memset(&kh_val(_fonthash, i), 0, sizeof(FontTexture));
+    font->AddContext(this);
+  }
+
+  auto& entry  = kh_val(_fonthash, i).pages[page];
+  int powsize  = font->GetPagePower(page);
+  bool realloc = true;
+  if(!entry.texture)
+  {
+    glGenTextures(1, &entry.texture);
+    _backend->LogError("glGenTextures");
+  }
+  else if(entry.power == powsize)
+  {
+    if(entry.dirty.right <= entry.dirty.left || entry.dirty.bottom <= entry.dirty.top)
+      return entry.texture;
+    realloc = false;
+  }
+
+  ActiveTexture(0);
+  BindTexture(0, entry.texture);
+  if(realloc)
+  {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    _backend->LogError("glTexParameteri");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    _backend->LogError("glTexParameteri");
+    entry.power = powsize;
+    entry.dirty = FG_Rect{ 0, 0, static_cast<float>(1 << powsize), static_cast<float>(1 << powsize) };
+  }
+  _uploadFont(font, page, entry, realloc);
+  entry.dirty = FG_Rect{ 0, 0, 0, 0 };
+  return entry.texture;
 }
-void Context::AddGlyph(uint32_t g)
+
+// Uploads the dirty part of the staging atlas, or allocates the whole texture if realloc is set. Single channel atlases
+// are stored as GL_R8 and swizzled so the image shader reads premultiplied white, unless swizzling isn't supported, in
+// which case the dirty area is expanded to GL_RGBA8 on the CPU first. Coverage and distances are linear, so only LCD
+// atlases are stored as sRGB.
+void Context::_uploadFont(const Font* font, int page, const FontPage& entry, bool realloc)
 {
-  int r;
-  kh_put_glyph(_glyphhash, g, &r);
+  const GLsizei dim   = (1 << entry.power);
+  const int channels  = font->GetChannels();
+  const bool swizzled = channels == 1 && HasCap(GLCaps::GLCAP_SWIZZLE);
+  const GLenum format = swizzled ? GL_RED : GL_RGBA;
+
+  GLint x   = static_cast<GLint>(entry.dirty.left);
+  GLint y   = static_cast<GLint>(entry.dirty.top);
+  GLsizei w = static_cast<GLsizei>(entry.dirty.right) - x;
+  GLsizei h = static_cast<GLsizei>(entry.dirty.bottom) - y;
+
+  const uint8_t* src = font->GetStaging(page) + ((size_t(y) * dim + x) * channels);
+  GLint rowlength    = dim;
+
+  std::unique_ptr<uint8_t[]> expanded;
+  if(channels == 1 && !swizzled)
+  {
+    expanded.reset(new uint8_t[size_t(w) * h * 4]);
+    for(GLsizei j = 0; j < h; ++j)
+      for(GLsizei k = 0; k < w; ++k)
+        memset(expanded.get() + ((size_t(j) * w + k) * 4), src[size_t(j) * dim + k], 4);
+    src       = expanded.get();
+    rowlength = w;
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, rowlength);
+  if(realloc)
+  {
+    if(swizzled)
+    {
+      const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_RED };
+      glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+      _backend->LogError("glTexParameteriv");
+    }
+    const GLint internal = swizzled ? GL_R8 : (channels == 1 ? GL_RGBA8 : GL_SRGB8_ALPHA8);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal, dim, dim, 0, format, GL_UNSIGNED_BYTE, src);
+    _backend->LogError("glTexImage2D");
+  }
+  else
+  {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, format, GL_UNSIGNED_BYTE, src);
+    _backend->LogError("glTexSubImage2D");
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }
 
-GLuint Context::GetFontTexture(const Font* font)
+void Context::DirtyFont(Font* font, int page, const FG_Rect& area)
 {
-  int r;
-  auto i      = kh_put_font(_fonthash, font, &r);
-  int powsize = font->GetSizePower();
-  GLuint tex;
-  if(!r)
-  {
-    auto pair = kh_val(_fonthash, i);
-    tex       = uint32_t(pair & 0xFFFFFFFF);
-    int size  = uint32_t(pair >> 32);
-    if(powsize <= size)
-      return tex;
-    powsize = size;
-  }
-  else if(r < 0)
-    return 0;
+  auto i = kh_get_font(_fonthash, font);
+  if(i >= kh_end(_fonthash) || !kh_exist(_fonthash, i))
+    return;
+
+  auto& dirty = kh_val(_fonthash, i).pages[page].dirty;
+  if(dirty.right <= dirty.left || dirty.bottom <= dirty.top)
+    dirty = area;
   else
   {
-    glGenTextures(1, &tex);
-    _backend->LogError("glGenTextures");
+    dirty.left   = std::min(dirty.left, area.left);
+    dirty.top    = std::min(dirty.top, area.top);
+    dirty.right  = std::max(dirty.right, area.right);
+    dirty.bottom = std::max(dirty.bottom, area.bottom);
   }
+}
 
-  glBindTexture(GL_TEXTURE_2D, tex);
-  _backend->LogError("glBindTexture");
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  _backend->LogError("glTexParameteri");
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  _backend->LogError("glTexParameteri");
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, (1 << powsize), (1 << powsize), 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-  _backend->LogError("glTexImage2D");
-  glBindTexture(GL_TEXTURE_2D, 0);
-  _backend->LogError("glBindTexture");
+void Context::EvictFontPage(Font* font, int page)
+{
+  if(_textfont == font && _textpage == page)
+  {
+    FlushText();
+    _textpage = -1;
+  }
+}
 
-  kh_val(_fonthash, i) = tex | (uint64_t(powsize) << 32);
-  return tex;
+void Context::ReleaseFont(Font* font)
+{
+  auto i = kh_get_font(_fonthash, font);
+  if(i < kh_end(_fonthash) && kh_exist(_fonthash, i))
+  {
+    if(_textfont == font)
+    {
+      _batch.clear();
+      _buffercount = 0;
+      _textfont    = nullptr;
+    }
+    for(auto& page : kh_val(_fonthash, i).pages)
+      if(page.texture)
+      {
+        glDeleteTextures(1, &page.texture);
+        _backend->LogError("glDeleteTextures");
+      }
+    kh_del_font(_fonthash, i);
+    InvalidateState();
+  }
+  font->RemoveContext(this);
 }
 
 GLenum Context::BlendValue(uint8_t value)
@@ -1040,18 +1555,29 @@ const FG_BlendState& Context::ApplyBlend(const FG_BlendState* blend, bool force)
   return _lastblend;
 }
 
-void Context::_flushbatchdraw(Font* font)
+void Context::FlushText()
 {
-  glActiveTexture(GL_TEXTURE0);
-  _backend->LogError("glActiveTexture");
-  glBindTexture(GL_TEXTURE_2D, GetFontTexture(font));
-  _backend->LogError("glBindTexture");
-
-  // We've already set up our batch indices so we can just use them
-  glDrawElements(GL_TRIANGLES, FlushBatch() * 6, GL_UNSIGNED_INT, nullptr);
+  if(!_buffercount)
+    return;
+
+  const bool sdf = _textfont->IsSDF();
+  GLuint shader  = sdf ? _sdfshader : _imageshader;
+  UseProgram(shader);
+  BindVAO(sdf ? _sdfobject : _imageobject);
+  Shader::SetUniform(this, GetUniform(shader, UNIFORM_MVP), GL_FLOAT_MAT4, (float*)_textmvp);
+  if(sdf)
+    Shader::SetUniform(this, GetUniform(shader, UNIFORM_BLUR), GL_FLOAT, &_textblur);
+  BindTexture(0, SyncFontTexture(_textfont, _textpage));
+
+  // We've already set up our batch indices so we can just use them, offset to wherever the batch landed in the stream
+  GLint first;
+  const bool basevertex = HasCap(GLCaps::GLCAP_BASE_VERTEX);
+  GLsizei count         = FlushBatch(sizeof(ImageVertex), first, !basevertex) * 6;
+  if(basevertex)
+    glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr, first);
+  else
+    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr);
   _backend->LogError("glDrawElements");
-  glBindVertexArray(0);
-  _backend->LogError("glBindVertexArray");
 }
 
 int mipmapImageGamma(const unsigned char* const orig, int width, int height, int channels, unsigned char* resampled,
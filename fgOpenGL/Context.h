@@ -10,9 +10,11 @@
 #include "compiler.h"
 #include "khash.h"
 #include "Layer.h"
+#include "Font.h"
 #include "Shader.h"
 #include "Asset.h"
 #include "VAO.h"
+#include "StreamBuffer.h"
 #include <math.h>
 #include <vector>
 #include <utility>
@@ -26,11 +28,23 @@ namespace GL {
   typedef int FG_Err;
   typedef std::pair<const Shader*, const Asset*> ShaderAsset;
 
+  // A context's copy of one page of a font's glyph atlas, along with the area of the staging page it hasn't uploaded yet
+  struct FontPage
+  {
+    GLuint texture; // 0 if this page hasn't been created on this context yet
+    int power;
+    FG_Rect dirty;
+  };
+
+  struct FontTexture
+  {
+    FontPage pages[Font::MAX_PAGES];
+  };
+
   KHASH_DECLARE(tex, const Asset*, GLuint);
   KHASH_DECLARE(shader, const Shader*, GLuint);
   KHASH_DECLARE(vao, ShaderAsset, VAO*);
-  KHASH_DECLARE(font, const Font*, uint64_t);
-  KHASH_DECLARE(glyph, uint32_t, char);
+  KHASH_DECLARE(font, Font*, FontTexture);
 
   enum class GLCaps
   {
@@ -43,6 +57,42 @@ namespace GL {
     GLCAP_INSTANCES = 64,
     GLCAP_INSTANCED_ARRAYS = 128,
     GLCAP_VAO = 256,
+    GLCAP_SYNC = 512,
+    GLCAP_BASE_VERTEX = 1024,
+    GLCAP_SWIZZLE = 2048,
+  };
+
+  // Indexes the instanced shape programs
+  enum ShapeKind
+  {
+    SHAPE_RECT,
+    SHAPE_CIRCLE,
+    SHAPE_ARC,
+    SHAPE_TRIANGLE,
+    SHAPE_COUNT,
+  };
+
+  // Parameter indices of the built-in shader layouts, which are set up in Backend's constructor
+  enum UniformIndex
+  {
+    UNIFORM_MVP           = 0,
+    UNIFORM_DIMBORDERBLUR = 1,
+    UNIFORM_CORNERS       = 2,
+    UNIFORM_FILL          = 3,
+    UNIFORM_OUTLINE       = 4,
+    UNIFORM_INFLATE       = 5,
+    UNIFORM_TEXTURE       = 1, // Image shader
+    UNIFORM_COLOR         = 1, // Line shader
+    UNIFORM_BLUR          = 2, // SDF text shader
+  };
+
+  // Counters for a single frame, reset by BeginDraw and logged at FG_Level_DEBUG by EndDraw
+  struct DrawStats
+  {
+    uint32_t textdraws;    // Text commands drawn
+    uint32_t textmerged;   // Text commands that were merged into the draw call of a previous one
+    uint32_t statechanges; // Binding changes that were sent to GL
+    uint32_t stateskipped; // Binding changes that were skipped because nothing would have changed
   };
 
   // A context may or may not have an associated OS window, for use inside other 3D engines.
@@ -78,26 +128,45 @@ namespace GL {
     void CreateResources();
     void DestroyResources();
     GLFWwindow* GetWindow() const { return _window; }
-    void Scissor(const FG_Rect& rect, float x, float y) const;
-    inline void Viewport(float w, float h) const { Viewport(static_cast<int>(ceilf(w)), static_cast<int>(ceilf(h))); }
-    void Viewport(int w, int h) const;
-    void StandardViewport() const;
+    void Scissor(const FG_Rect& rect, float x, float y);
+    inline void Viewport(float w, float h) { Viewport(static_cast<int>(ceilf(w)), static_cast<int>(ceilf(h))); }
+    void Viewport(int w, int h);
+    void StandardViewport();
+    // These skip the GL call if the binding wouldn't change. Anything that binds objects or deletes them without going
+    // through these functions has to call InvalidateState() afterwards.
+    void UseProgram(GLuint program);
+    void BindVAO(VAO* vao);
+    void BindArrayBuffer(GLuint buffer);
+    void ActiveTexture(GLuint unit);
+    void BindTexture(GLuint unit, GLuint texture);
+    void InvalidateState();
     void AppendBatch(const void* vertices, GLsizeiptr bytes, GLsizei count);
-    GLsizei FlushBatch();
+    // Uploads the pending batch to the stream buffer, returning the number of elements and the index of the first vertex
+    GLsizei FlushBatch(GLsizeiptr stride, GLint& first, bool rewind = false);
+    void FlushShapes();
+    void FlushText();
     void SetDim(const FG_Vec& dim);
     GLuint LoadAsset(Asset* asset);
     GLuint LoadShader(Shader* shader);
+    GLint GetUniform(GLuint program, uint32_t index) const;
     VAO* LoadVAO(Shader* shader, Asset* asset);
-    bool CheckGlyph(uint32_t g);
-    void AddGlyph(uint32_t g);
-    GLuint GetFontTexture(const Font* font);
-    bool CheckFlush(GLintptr bytes) { return (_bufferoffset + bytes > BATCH_BYTES); }
+    // Returns the texture of a font's atlas page, creating it or uploading whatever changed in the staging page
+    GLuint SyncFontTexture(Font* font, int page);
+    void DirtyFont(Font* font, int page, const FG_Rect& area);
+    // Draws any pending text that still needs this page, because the font is about to reuse it for other glyphs
+    void EvictFontPage(Font* font, int page);
+    void ReleaseFont(Font* font);
+    bool CheckFlush(GLintptr bytes) { return (_batch.size() + bytes > BATCH_BYTES); }
     const FG_BlendState& ApplyBlend(const FG_BlendState* blend, bool force = false);
     void FlipFlag(int diff, int flags, int flag, int option);
     virtual void DirtyRect(const FG_Rect* rect) {}
     inline Backend* GetBackend() const { return _backend; }
+    inline TargetPool& GetTargets() { return _targets; }
+    // Counters for the frame being drawn, or the last one drawn once EndDraw has been called
+    inline const DrawStats& GetStats() const { return _stats; }
     mat4x4& GetProjection() { return _layers.size() > 0 ? _layers.back()->proj : proj; }
     void SetDefaultState();
+    inline bool HasCap(GLCaps cap) const { return (_caps & static_cast<int>(cap)) != 0; }
 
     inline void ColorFloats(const FG_Color& c, float (&colors)[4], bool linearize)
     {
@@ -129,6 +198,7 @@ namespace GL {
     mat4x4 proj;
     FG_MsgReceiver* _element;
     GLuint _imageshader;
+    GLuint _sdfshader;
     GLuint _rectshader;
     GLuint _circleshader;
     GLuint _arcshader;
@@ -137,19 +207,28 @@ namespace GL {
     VAO* _quadobject;
     GLuint _quadbuffer;
     VAO* _imageobject;
-    GLuint _imagebuffer;
+    VAO* _sdfobject; // Same buffers as _imageobject, bound to the attributes of _sdfshader
     GLuint _imageindices;
     VAO* _lineobject;
-    GLuint _linebuffer;
+    StreamBuffer* _streambuffer; // Holds the vertices of both _imageobject and _lineobject
+    GLuint _instancedshaders[SHAPE_COUNT];
+    VAO* _instancedobjects[SHAPE_COUNT];
+    GLuint _ubershader; // 0 if the uber shader is disabled
+    VAO* _uberobject;
+    GLuint _instancebuffer;
     FG_BlendState _lastblend;
 
-    static const size_t BATCH_BYTES = (1 << 14);
-    static const size_t MAX_INDICES = BATCH_BYTES / sizeof(GLuint);
+    static const size_t STREAM_BYTES = (1 << 22);
+    static const size_t BATCH_BYTES  = (1 << 20); // Most vertex data a single batched draw can upload
+    static const size_t MAX_INSTANCES = 512;
+    static const size_t MAX_INDICES  = (BATCH_BYTES / (sizeof(ImageVertex) * 4)) * 6;
     static const FG_BlendState NORMAL_BLEND;      // For straight-alpha blending
     static const FG_BlendState PREMULTIPLY_BLEND; // For premultiplied blending (the default)
     static const FG_BlendState DEFAULT_BLEND;     // OpenGL default settings
 
     static const int SOIL_FLAG_LINEAR_RGB = 1024;
+    static const GLuint MAX_TEXTURE_UNITS = 32;
+    static const GLuint UNKNOWN_BINDING   = ~0u;
 
     struct GLState
     {
@@ -167,13 +246,24 @@ namespace GL {
       GLint alphasrc;
       GLint alphadest;
       GLint alphaop;
+      GLboolean scissortest;
+      GLint scissor[4];
+      GLint viewport[4];
+      GLint program;
+      GLint vao;
+      GLint arraybuffer;
+      GLint activetexture;
+      GLint textures[MAX_TEXTURE_UNITS];
+      uint32_t savedunits; // Bitmask of units whose binding was saved the first time we changed it
     } _statestore;
 
+    DrawStats _stats;
+
   protected:
     GLuint _createBuffer(size_t stride, size_t count, const void* init);
     GLuint _genIndices(size_t num);
-    void _flushbatchdraw(Font* font);
-    void _drawStandard(GLuint shader, VAO* vao, mat4x4 proj, const FG_Rect& area, const FG_Rect& corners,
+    void _uploadFont(const Font* font, int page, const FontPage& entry, bool realloc);
+    void _drawStandard(GLuint shader, ShapeKind kind, mat4x4 proj, const FG_Rect& area, const FG_Rect& corners,
                        FG_Color fillColor, float border, FG_Color borderColor, float blur, float rotate, float z,
                        bool linearize);
     unsigned int _createTexture(const unsigned char* const data, int width, int height, int channels,
@@ -203,17 +293,39 @@ namespace GL {
       v[3].posUV[3] = uv.bottom / y;
     }
 
+    // Shadow copy of the current GL bindings. UNKNOWN_BINDING (or vaoknown = false) forces the next call through.
+    struct GLBindings
+    {
+      GLuint program;
+      VAO* vao;
+      bool vaoknown;
+      GLuint arraybuffer;
+      GLuint activeunit;
+      GLuint textures[MAX_TEXTURE_UNITS];
+      GLint scissor[4]; // Width of -1 if unknown
+      GLint viewport[4];
+    } _bound;
+
     GLFWwindow* _window;
     Backend* _backend;
     std::vector<FG_Rect> _clipstack;
     std::vector<Layer*> _layers;
-    GLintptr _bufferoffset;
+    std::vector<uint8_t> _batch; // Staged vertices that haven't been uploaded yet
     GLsizei _buffercount;
+    Font* _textfont; // Atlas font, page and MVP shared by the pending text batch
+    int _textpage;
+    int _textpower;
+    float _textblur; // Only matters for SDF fonts
+    mat4x4 _textmvp;
     kh_tex_s* _texhash;
-    kh_font_s* _fonthash;   // Holds the initialized texture for this font on this context
-    kh_glyph_s* _glyphhash; // The set of all glyphs that have been initialized
+    kh_font_s* _fonthash; // Holds the initialized texture for this font on this context
     kh_shader_s* _shaderhash;
     kh_vao_s* _vaohash;
+    kh_uniform_s* _uniformhash; // Uniform locations of every program created on this context
+    std::vector<ShapeInstance> _instances; // Pending shapes that share _instancekind, drawn by FlushShapes()
+    ShapeKind _instancekind;
+    int _caps;
+    TargetPool _targets; // Spare layer framebuffers
     bool _initialized;
     bool _clipped;
   };
@@ -0,0 +1,211 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "FaceCache.h"
+#include "platform.h"
+#include "ft2build.h"
+#include FT_FREETYPE_H
+#include <algorithm>
+#include <utility>
+
+#ifdef FG_PLATFORM_POSIX
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+using namespace GL;
+
+FaceCache::FaceCache()
+#ifdef FG_PLATFORM_POSIX
+  :
+  _config(nullptr)
+#endif
+{}
+
+// Faces are closed by FT_Done_FreeType before this runs, so only the data is left to free
+FaceCache::~FaceCache()
+{
+  for(auto& f : _files)
+  {
+    _unmap(f.second);
+    delete f.second;
+  }
+#ifdef FG_PLATFORM_POSIX
+  if(_config)
+    FcConfigDestroy(_config);
+#endif
+}
+
+#ifdef FG_PLATFORM_POSIX
+const char* FaceCache::Match(const char* family, int weight, bool italic)
+{
+  std::string key = std::string(family) + '\0' + std::to_string(weight) + (italic ? 'i' : 'n');
+  auto cached     = _matches.find(key);
+  if(cached != _matches.end())
+    return cached->second.empty() ? nullptr : cached->second.c_str();
+
+  switch(weight)
+  {
+  case 100: weight = FC_WEIGHT_THIN; break;
+  case 200: weight = FC_WEIGHT_EXTRALIGHT; break;
+  case 300: weight = FC_WEIGHT_LIGHT; break;
+  case 350: weight = FC_WEIGHT_LIGHT; break;
+  case 400: weight = FC_WEIGHT_NORMAL; break;
+  case 500: weight = FC_WEIGHT_MEDIUM; break;
+  case 600: weight = FC_WEIGHT_SEMIBOLD; break;
+  case 700: weight = FC_WEIGHT_BOLD; break;
+  case 800: weight = FC_WEIGHT_EXTRABOLD; break;
+  case 900: weight = FC_WEIGHT_BLACK; break;
+  case 950: weight = FC_WEIGHT_EXTRABLACK; break;
+  default: weight /= 5; break; // This doesn't really work but we try anyway
+  }
+
+  if(!_config)
+    _config = FcInitLoadConfigAndFonts();
+
+  FcPattern* pat = FcNameParse((const FcChar8*)family);
+  FcPatternAddInteger(pat, FC_WEIGHT, weight);
+  FcPatternAddInteger(pat, FC_SLANT, italic ? 100 : 0);
+  FcConfigSubstitute(_config, pat, FcMatchPattern);
+  FcDefaultSubstitute(pat);
+
+  FcResult result;
+  FcPattern* match = FcFontMatch(_config, pat, &result);
+  std::string& file = _matches[key];
+
+  if(match)
+  {
+    FcChar8* str = NULL;
+    if(FcPatternGetString(match, FC_FILE, 0, &str) == FcResultMatch)
+      file = (const char*)str;
+  }
+
+  FcPatternDestroy(match);
+  FcPatternDestroy(pat);
+  return file.empty() ? nullptr : file.c_str();
+}
+#endif
+
+FontFile* FaceCache::Open(FT_Library lib, const std::string& file)
+{
+  auto existing = _files.find(file);
+  if(existing != _files.end())
+  {
+    ++existing->second->refs;
+    return existing->second;
+  }
+
+  auto f = new FontFile{ file, nullptr, 0, nullptr, 0, true };
+#ifdef FG_PLATFORM_WIN32
+  std::wstring wfile(MultiByteToWideChar(CP_UTF8, 0, file.c_str(), -1, 0, 0), 0);
+  MultiByteToWideChar(CP_UTF8, 0, file.c_str(), -1, wfile.data(), static_cast<int>(wfile.size()));
+  HANDLE handle = CreateFileW(wfile.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+  if(handle != INVALID_HANDLE_VALUE)
+  {
+    LARGE_INTEGER size;
+    HANDLE mapping = (GetFileSizeEx(handle, &size) && size.QuadPart > 0) ?
+                       CreateFileMappingW(handle, NULL, PAGE_READONLY, 0, 0, NULL) :
+                       NULL;
+    if(mapping) // The view stays valid after both handles are closed
+    {
+      f->data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      f->size = static_cast<size_t>(size.QuadPart);
+      CloseHandle(mapping);
+    }
+    CloseHandle(handle);
+  }
+#else
+  int fd = open(file.c_str(), O_RDONLY);
+  if(fd >= 0)
+  {
+    struct stat info;
+    if(fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+      void* p = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if(p != MAP_FAILED)
+      {
+        f->data = (const uint8_t*)p;
+        f->size = static_cast<size_t>(info.st_size);
+      }
+    }
+    close(fd);
+  }
+#endif
+
+  return _open(lib, f);
+}
+
+FontFile* FaceCache::Open(FT_Library lib, const std::string& key, std::vector<uint8_t>&& data)
+{
+  auto existing = _files.find(key);
+  if(existing != _files.end())
+  {
+    ++existing->second->refs;
+    return existing->second;
+  }
+
+  auto f  = new FontFile{ key, nullptr, 0, nullptr, 0, false, std::move(data) };
+  f->data = f->copy.data();
+  f->size = f->copy.size();
+  return _open(lib, f);
+}
+
+FontFile* FaceCache::_open(FT_Library lib, FontFile* file)
+{
+  if(!file->data || FT_New_Memory_Face(lib, file->data, static_cast<FT_Long>(file->size), 0, &file->face) != 0)
+  {
+    _unmap(file);
+    delete file;
+    return nullptr;
+  }
+
+  file->refs        = 1;
+  _files[file->key] = file;
+  return file;
+}
+
+void FaceCache::Release(FontFile* file)
+{
+  if(--file->refs > 0)
+    return;
+
+  FT_Done_Face(file->face);
+  _files.erase(file->key);
+  _unmap(file);
+  delete file;
+}
+
+bool FontFile::Covers(uint32_t codepoint)
+{
+  if(!scanned)
+  {
+    FT_UInt index;
+    for(FT_ULong c = FT_Get_First_Char(face, &index); index != 0; c = FT_Get_Next_Char(face, c, &index))
+    {
+      if(!coverage.empty() && coverage.back().second + 1 == c)
+        coverage.back().second = static_cast<uint32_t>(c);
+      else
+        coverage.emplace_back(static_cast<uint32_t>(c), static_cast<uint32_t>(c));
+    }
+    coverage.shrink_to_fit();
+    scanned = true;
+  }
+
+  auto range = std::upper_bound(coverage.begin(), coverage.end(), codepoint,
+                                [](uint32_t c, const std::pair<uint32_t, uint32_t>& r) { return c < r.first; });
+  return range != coverage.begin() && codepoint <= (--range)->second;
+}
+
+void FaceCache::_unmap(FontFile* file)
+{
+  if(!file->mapped || !file->data)
+    return;
+#ifdef FG_PLATFORM_WIN32
+  UnmapViewOfFile(file->data);
+#else
+  munmap(const_cast<uint8_t*>(file->data), file->size);
+#endif
+}
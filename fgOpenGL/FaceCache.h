@@ -0,0 +1,71 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#ifndef GL__FACE_CACHE_H
+#define GL__FACE_CACHE_H
+
+#include "compiler.h"
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct FT_FaceRec_;
+struct FT_LibraryRec_;
+struct _FcConfig;
+
+namespace GL {
+  struct Font;
+
+  // A font file and the FT_Face opened on it, shared by every Font created from it. Each Font gives the face its own
+  // FT_Size and activates it before using the face. Worker threads open their own faces on the same data, which is
+  // never written to.
+  struct FontFile
+  {
+    std::string key; // Path of the file, or a unique name for data that only exists in memory
+    const uint8_t* data;
+    size_t size;
+    struct FT_FaceRec_* face;
+    int refs;
+    bool mapped;               // If false, the data is owned by copy
+    std::vector<uint8_t> copy;
+    std::vector<std::pair<uint32_t, uint32_t>> coverage; // Inclusive ranges of characters the face maps
+    bool scanned = false;                                // Whether coverage has been read from the character map yet
+    std::vector<Font*> sdf; // SDF fonts made from this file. They all share the atlas of the first one.
+
+    // Binary searches the coverage, which is read from the face the first time it's needed
+    bool Covers(uint32_t codepoint);
+  };
+
+  // Keeps one fontconfig configuration and one FT_Face per font file for the whole backend, so creating the same
+  // family at another size or weight doesn't match and parse the font all over again.
+  class FaceCache
+  {
+  public:
+    FaceCache();
+    ~FaceCache();
+#ifdef FG_PLATFORM_POSIX
+    // Returns the file fontconfig picks for this family, or null if there isn't one. Weight is a CSS weight.
+    const char* Match(const char* family, int weight, bool italic);
+#endif
+    // Maps the file into memory and opens a face for it, or returns the one that's already open. Returns null if the
+    // file can't be opened.
+    FontFile* Open(struct FT_LibraryRec_* lib, const std::string& file);
+    // Takes over font data that doesn't come from a file FreeType could open itself
+    FontFile* Open(struct FT_LibraryRec_* lib, const std::string& key, std::vector<uint8_t>&& data);
+    void Release(FontFile* file);
+
+  private:
+    FontFile* _open(struct FT_LibraryRec_* lib, FontFile* file);
+    static void _unmap(FontFile* file);
+
+    std::unordered_map<std::string, FontFile*> _files;
+#ifdef FG_PLATFORM_POSIX
+    std::unordered_map<std::string, std::string> _matches; // Empty if nothing matched
+    struct _FcConfig* _config;
+#endif
+  };
+}
+
+#endif
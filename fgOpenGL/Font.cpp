@@ -3,14 +3,25 @@
 
 #include "BackendGL.h"
 #include "Font.h"
+#include "FaceCache.h"
 #include "platform.h"
 #include "ft2build.h"
 #include FT_FREETYPE_H
+#include FT_MODULE_H
+#include FT_SIZES_H
 #include "freetype/freetype.h"
+#include "hb.h"
+#include "hb-ft.h"
+#include <algorithm>
 #include <assert.h>
 #include <malloc.h>
 #include <math.h>
 
+// FT_RENDER_MODE_SDF was added in FreeType 2.11
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+  #define FG_FREETYPE_SDF
+#endif
+
 #ifdef FG_PLATFORM_WIN32
   #include <Shlobj.h>
   #include <dwrite_1.h>
@@ -18,22 +29,41 @@
 
 namespace GL {
   __KHASH_IMPL(glyphmap, , int, Glyph, 1, kh_int_hash_func2, kh_int_hash_equal);
+  __KHASH_IMPL(codeset, , int, char, 0, kh_int_hash_func2, kh_int_hash_equal);
+  __KHASH_IMPL(kernmap, , uint64_t, int32_t, 1, kh_int64_hash_func, kh_int64_hash_equal);
+  __KHASH_IMPL(fallbackmap, , int, int, 1, kh_int_hash_func2, kh_int_hash_equal);
 }
 
 using namespace GL;
 
 Font::Font(Backend* backend, const char* family, int weight, bool italic, int psize, FG_AntiAliasing antialias,
            const FG_Vec& _dpi) :
-  _backend(backend), _path(family), _glyphs(kh_init_glyphmap()), _curpower(0), _nexty(1)
+  _backend(backend),
+  _path(family),
+  _file(nullptr),
+  _face(nullptr),
+  _size(nullptr),
+  _glyphs(kh_init_glyphmap()),
+  _tick(0),
+  _scale(1.0f),
+  _metricscale{ 1.0f, 1.0f },
+  _atlas(this),
+  _queued(kh_init_codeset()),
+  _hasready(false),
+  _kernpairs(kh_init_kernmap()),
+  _hbfont(nullptr),
+  _hbbuffer(hb_buffer_create()),
+  _missing(kh_init_codeset()),
+  _fallbackmap(kh_init_fallbackmap()),
+  _generation(0)
 {
-  _cur = { 1, 1 };
   pt   = psize;
   dpi  = _dpi;
   aa   = antialias;
-  FT_Error err;
+  FT_Error err = 0;
 #ifdef FG_PLATFORM_WIN32
   if(exists(_path)) // Check if we were just passed an entire path instead of a font family
-    err = FT_New_Face(_backend->_ftlib, _path.u8string().c_str(), 0, &_face);
+    _file = _backend->_faces.Open(_backend->_ftlib, _path.u8string());
   else
   {
     IDWriteTextFormat* format = 0;
@@ -111,8 +141,11 @@ Font::Font(Backend* backend, const char* family, int weight, bool italic, int ps
 
               if(SUCCEEDED(hr))
               {
-                err = FT_New_Memory_Face(_backend->_ftlib, (const FT_Byte*)start, filesize, 0, &_face);
+                // FreeType reads from the data for as long as the face is open, so it has to outlive the fragment
+                std::string key((const char*)refkey, refkeysize);
+                std::vector<uint8_t> data((const uint8_t*)start, (const uint8_t*)start + filesize);
                 stream->ReleaseFileFragment(ctx);
+                _file = _backend->_faces.Open(_backend->_ftlib, "dwrite:" + key, std::move(data));
               }
             }
           }
@@ -146,53 +179,26 @@ Font::Font(Backend* backend, const char* family, int weight, bool italic, int ps
     collection->Release();
   }
 #else
-  switch(weight)
-  {
-  case 100: weight = FC_WEIGHT_THIN; break;
-  case 200: weight = FC_WEIGHT_EXTRALIGHT; break;
-  case 300: weight = FC_WEIGHT_LIGHT; break;
-  case 350: weight = FC_WEIGHT_LIGHT; break;
-  case 400: weight = FC_WEIGHT_NORMAL; break;
-  case 500: weight = FC_WEIGHT_MEDIUM; break;
-  case 600: weight = FC_WEIGHT_SEMIBOLD; break;
-  case 700: weight = FC_WEIGHT_BOLD; break;
-  case 800: weight = FC_WEIGHT_EXTRABOLD; break;
-  case 900: weight = FC_WEIGHT_BLACK; break;
-  case 950: weight = FC_WEIGHT_EXTRABLACK; break;
-  default: weight /= 5; break; // This doesn't really work but we try anyway
-  }
-
-  FcConfig* config = FcInitLoadConfigAndFonts();
-  FcPattern* pat   = FcNameParse((const FcChar8*)family);
-  FcPatternAddInteger(pat, FC_SIZE, pt);
-  FcPatternAddInteger(pat, FC_WEIGHT, weight);
-  FcPatternAddInteger(pat, FC_SLANT, italic ? 100 : 0);
-  FcConfigSubstitute(config, pat, FcMatchPattern);
-  FcDefaultSubstitute(pat);
+  if(const char* file = _backend->_faces.Match(family, weight, italic))
+    _file = _backend->_faces.Open(_backend->_ftlib, file);
+#endif
 
-  char* fontFile;
-  FcResult result;
-  FcPattern* match = FcFontMatch(config, pat, &result);
+  const float FT_COEF = (1.0f / 64.0f);
 
-  if(match)
+  // Every size of a font shares one face, with its own FT_Size selected whenever this font uses it
+  if(_file)
   {
-    FcChar8* str = NULL;
-
-    if(FcPatternGetString(match, FC_FILE, 0, &str) == FcResultMatch)
-      err = FT_New_Face(_backend->_ftlib, (const char*)str, 0, &_face);
+    _face = _file->face;
+    err   = FT_New_Size(_face, &_size);
+    if(err == 0)
+      err = FT_Activate_Size(_size);
   }
 
-  FcPatternDestroy(match);
-  FcPatternDestroy(pat);
-  FcConfigDestroy(config);
-#endif
-
-  const float FT_COEF = (1.0f / 64.0f);
-
   if(err != 0 || !_face)
   {
     (*_backend->_log)(_backend->_root, FG_Level_ERROR, "Font %s does not exist or cannot be found.",
                       _path.u8string().c_str());
+    _cleanup();
     return;
   }
 
@@ -244,28 +250,110 @@ Font::Font(Backend* backend, const char* family, int weight, bool italic, int ps
 
   // points are defined as 1/72 inches, so the scaling factor is DPI/72.0f to get the true glyph size. Example: a 12 point
   // font at 96 DPI is 12 * 96/72 = 16 pixels high
+  float em = std::max(dpi.x, dpi.y) / 72.0f * pt;
+
+  if(IsSDF())
+  {
+#ifdef FG_FREETYPE_SDF
+    if(!(_face->face_flags & FT_FACE_FLAG_SCALABLE) || FT_Set_Pixel_Sizes(_face, 0, SDF_EM) != 0)
+#endif
+    {
+      (*_backend->_log)(_backend->_root, FG_Level_WARNING, "Font %s can't be rendered as a signed distance field.",
+                        _path.u8string().c_str());
+      aa = static_cast<FG_AntiAliasing>(aa & ~FG_AntiAliasing_SDF);
+    }
+#ifdef FG_FREETYPE_SDF
+    else
+    {
+      // The metrics above are still for the requested size, but the face now renders at SDF_EM
+      _scale       = (dpi.y / 72.0f * pt) / SDF_EM;
+      _metricscale = { _scale * Backend::BASE_DPI / dpi.x, _scale * Backend::BASE_DPI / dpi.y };
+      em           = static_cast<float>(SDF_EM);
+      FT_Int spr   = SDF_SPREAD;
+      FT_Property_Set(_backend->_ftlib, "sdf", "spread", &spr);
+      FT_Property_Set(_backend->_ftlib, "bsdf", "spread", &spr);
+
+      // Every size renders the same distance fields, so they all go into one atlas
+      _file->sdf.push_back(this);
+      _atlas = _file->sdf.front();
+    }
+#endif
+  }
+
   // This finds the next highest power of two
-  _curpower   = (uint32_t)ceil(log(std::max(dpi.x, dpi.y) / 72.0f * 8.0f * pt) / log(2));
+  int power   = (int)ceil(log(em * 8.0f) / log(2));
   baseline    = _ascender;
   _haskerning = FT_HAS_KERNING(_face) != 0;
   data.data   = this;
-  _last       = { 0, 0 };
+  if(_haskerning)
+    _kernrows.resize(KERN_SLOTS);
+  _channels   = (!IsSDF() && (aa & (FG_AntiAliasing_LCD | FG_AntiAliasing_LCD_V))) ? 4 : 1;
+  if(_atlas == this)
+    _addpage(std::min(power, MAX_PAGE_POWER));
+
+  // Shaping has to see the same hinted advances the glyphs are rasterized with
+  _hbfont = hb_ft_font_create_referenced(_face);
+  hb_ft_font_set_load_flags(_hbfont, IsSDF() ? FT_LOAD_NO_HINTING : (FT_LOAD_FORCE_AUTOHINT | _ftaa(aa)));
 }
 
 Font::~Font()
 {
+  _backend->_workers.Forget(this);
+  SetFallback(nullptr, 0);
+  while(!_users.empty()) // _dropfallback removes the user from _users
+    _users.back()->_dropfallback(this);
+  // ReleaseFont calls RemoveContext, so we can't iterate over _contexts directly
+  while(!_contexts.empty())
+    _contexts.back()->ReleaseFont(this);
+
+  // If other sizes are still using this font's atlas, the next one takes it over. Contexts have already let go of
+  // their textures, so it's uploaded again from the staging pages the next time it's drawn.
+  if(_file && IsSDF())
+  {
+    auto& sdf = _file->sdf;
+    sdf.erase(std::remove(sdf.begin(), sdf.end(), this), sdf.end());
+    if(_atlas == this && !sdf.empty())
+    {
+      Font* heir = sdf.front();
+      heir->_pages.swap(_pages);
+      heir->_tick = _tick;
+      std::swap(heir->_glyphs, _glyphs);
+      std::swap(heir->_missing, _missing);
+      for(auto f : sdf)
+        f->_atlas = heir;
+    }
+  }
   _cleanup();
   kh_destroy_glyphmap(_glyphs);
+  kh_destroy_codeset(_queued);
+  kh_destroy_kernmap(_kernpairs);
+  hb_buffer_destroy(_hbbuffer);
+  kh_destroy_codeset(_missing);
+  kh_destroy_fallbackmap(_fallbackmap);
 }
 
 void Font::_cleanup()
 {
-  if(_face)
-    FT_Done_Face(_face);
+  if(_hbfont)
+    hb_font_destroy(_hbfont);
+  _hbfont = nullptr;
+  if(_size)
+    FT_Done_Size(_size);
+  _size = nullptr;
+  if(_file)
+    _backend->_faces.Release(_file);
+  _file = nullptr;
   _face = nullptr;
 }
 
-int Font::_ftaa(FG_AntiAliasing antialias)
+// Other sizes of this font may have used the shared face since this one did
+void Font::_activate()
+{
+  if(_face && _face->size != _size)
+    FT_Activate_Size(_size);
+}
+
+int Font::_ftaa(FG_AntiAliasing antialias) const
 {
   switch(antialias&(~FG_AntiAliasing_SDF))
   {
@@ -286,96 +374,264 @@ void Font::_enforceantialias(int ftaa)
      default: FT_Library_SetLcdFilter(_backend->_ftlib, FT_LCD_FILTER_NONE); break;
   }*/
 }
-Glyph* Font::LoadGlyph(char32_t codepoint)
+Glyph* Font::LoadGlyph(uint32_t index)
 {
-  int r;
-  auto iter = kh_put_glyphmap(_glyphs, codepoint, &r);
-  if(!r)
-    return &kh_val(_glyphs, iter);
-  if(r < 0)
-    return nullptr;
+  if(_atlas != this)
+    return _atlas->LoadGlyph(index);
 
-  // if this throws an error, remove it as a possible renderable codepoint
-  if(FT_Load_Char(_face, codepoint, FT_LOAD_RENDER | FT_LOAD_FORCE_AUTOHINT | _ftaa(aa)) != 0)
+  auto iter = kh_get_glyphmap(_glyphs, index);
+  if(iter == kh_end(_glyphs) && _hasready.load(std::memory_order_acquire))
   {
-    (*_backend->_log)(_backend->_root, FG_Level_ERROR, "codepoint %i in %s failed to load.", codepoint,
+    _collect(); // A worker may have already finished it
+    iter = kh_get_glyphmap(_glyphs, index);
+  }
+
+  if(iter != kh_end(_glyphs))
+  {
+    Glyph& g = kh_val(_glyphs, iter);
+    if(g.page >= 0)
+      _pages[g.page].used = ++_tick;
+    return &g;
+  }
+  if(kh_get_codeset(_missing, index) != kh_end(_missing))
+    return nullptr;
+
+  // If the glyph is still queued, we need it now and can't wait, so the worker's copy will just be thrown away
+  _enforceantialias(_ftaa(aa));
+  _activate();
+  RasterGlyph raster;
+  Glyph* g = nullptr;
+  if(!_rasterize(_face, index, raster))
+    (*_backend->_log)(_backend->_root, FG_Level_ERROR, "glyph %u in %s failed to load.", index,
                       _path.u8string().c_str());
+  else
+    g = _place(index, raster);
+
+  if(!g) // Remember the failure, so this glyph is never loaded or reported again
+  {
+    int r;
+    kh_put_codeset(_missing, index, &r);
+  }
+  return g;
+}
+
+float Font::GetGlyphAdvance(uint32_t index)
+{
+  if(!_hbfont)
+    return 0.0f;
+  _activate(); // HarfBuzz measures glyphs with whatever size the face has active
+  const float unit = (1.0f / 64.0f) * _scale * Backend::BASE_DPI; // Same scaling Shape uses
+  return hb_font_get_glyph_h_advance(_hbfont, index) * unit / dpi.x;
+}
+
+float Font::GetCharAdvance(char32_t codepoint)
+{
+  if(!_face)
+    return 0.0f;
+  uint32_t index = FT_Get_Char_Index(_face, codepoint);
+  if(!index)
+    if(Font* fallback = FindFallback(codepoint))
+      return fallback->GetCharAdvance(codepoint);
+  return GetGlyphAdvance(index); // Bad glyphs usually just have 0 width
+}
+
+FG_Rect Font::GetBounds(const Glyph& g, FG_Vec pen) const
+{
+  FG_Rect r;
+  r.left   = pen.x + (g.bearing.x * _metricscale.x);
+  r.top    = pen.y - (g.bearing.y * _metricscale.y);
+  r.right  = r.left + (g.width * _scale);
+  r.bottom = r.top + (g.height * _scale);
+  return r;
+}
+
+void Font::SetFallback(Font* const* fonts, size_t count)
+{
+  for(auto f : _fallbacks)
+    f->_users.erase(std::remove(f->_users.begin(), f->_users.end(), this), f->_users.end());
+
+  _fallbacks.clear();
+  for(size_t i = 0; i < count; ++i)
+    if(fonts[i] && fonts[i] != this)
+    {
+      _fallbacks.push_back(fonts[i]);
+      fonts[i]->_users.push_back(this);
+    }
+
+  // Shaped runs may hold glyphs from the old chain, and so may any layout made before now
+  kh_clear_fallbackmap(_fallbackmap);
+  _runs.clear();
+  _runindex.clear();
+  ++_generation;
+}
+
+void Font::_dropfallback(Font* font)
+{
+  std::vector<Font*> fallbacks;
+  for(auto f : _fallbacks)
+    if(f != font)
+      fallbacks.push_back(f);
+  SetFallback(fallbacks.data(), fallbacks.size());
+}
+
+Font* Font::FindFallback(char32_t codepoint)
+{
+  if(_fallbacks.empty())
     return nullptr;
+
+  int r;
+  auto iter = kh_put_fallbackmap(_fallbackmap, codepoint, &r);
+  if(r < 0)
+    return nullptr;
+  if(r > 0)
+  {
+    int found = -1;
+    for(size_t i = 0; i < _fallbacks.size() && found < 0; ++i)
+      if(_fallbacks[i]->_file && _fallbacks[i]->_file->Covers(codepoint))
+        found = static_cast<int>(i);
+    kh_val(_fallbackmap, iter) = found;
   }
 
-  FT_Bitmap& gbmp     = _face->glyph->bitmap;
-  const float FT_COEF = (1.0f / 64.0f);
-  uint32_t width      = (gbmp.pixel_mode == FT_PIXEL_MODE_LCD) ? (gbmp.width / 3) : gbmp.width;
-  uint32_t height     = gbmp.rows;
-  FG_Vec offset       = _cur;
+  int slot = kh_val(_fallbackmap, iter);
+  return slot < 0 ? nullptr : _fallbacks[slot];
+}
 
-  Glyph& g = kh_val(_glyphs, iter);
-  g        = Glyph{};
+bool Font::_openface(FT_Library lib, FT_Face& face) const
+{
+  if(FT_New_Memory_Face(lib, _file->data, static_cast<FT_Long>(_file->size), 0, &face) != 0)
+  {
+    face = nullptr;
+    return false;
+  }
 
-  if(_cur.x + width + 1 > (1 << _curpower)) // if true we ran past the edge (+1 for one pixel buffer on edges)
+  FT_Error err;
+  if(IsSDF())
   {
-    _cur.y = _nexty;
-    _cur.x = (_cur.y < _last.y) ? 1 + _last.x : 1;
+    FT_Int spr = SDF_SPREAD;
+    FT_Property_Set(lib, "sdf", "spread", &spr);
+    FT_Property_Set(lib, "bsdf", "spread", &spr);
+    err = FT_Set_Pixel_Sizes(face, 0, SDF_EM);
   }
-  if(_cur.y + height + 1 > (1 << _curpower)) // if true we need to resize the texture
+  else
   {
-    _last = { float(1 << _curpower), float(1 << _curpower) };
+    FT_Pos ptsize = FT_F26Dot6(pt * 64);
+    err           = FT_Set_Char_Size(face, ptsize, ptsize, static_cast<FT_UInt>(floor(dpi.x)),
+                           static_cast<FT_UInt>(floor(dpi.y)));
+  }
 
-    ++_curpower;
-    _cur.y = 0;
-    _cur.x = (_cur.y < _last.y) ? 1 + _last.x : 1;
-    _nexty = 1;
+  if(err != 0)
+  {
+    FT_Done_Face(face);
+    face = nullptr;
   }
+  return face != nullptr;
+}
 
-  FG_Vec invdpiscale = { Backend::BASE_DPI / dpi.x, Backend::BASE_DPI / dpi.y };
-  g.uv               = { _cur.x, _cur.y, (_cur.x + width), (_cur.y + height) };
-  g.advance          = (_face->glyph->advance.x * FT_COEF * invdpiscale.x);
-  g.bearing.x        = (_face->glyph->metrics.horiBearingX * FT_COEF * invdpiscale.x);
-  g.bearing.y        = (_face->glyph->metrics.horiBearingY * FT_COEF * invdpiscale.y);
-  g.width            = (float)width;
-  g.height           = (float)height;
+// Renders a glyph with the given face into a tightly packed bitmap, without touching the atlas
+bool Font::_rasterize(FT_Face face, uint32_t index, RasterGlyph& out) const
+{
+  if(!face)
+    return false;
 
-  _cur.x += width + 1; // one pixel buffer
-  if(_nexty < _cur.y + height)
-    _nexty = _cur.y + height + 1; // one pixel buffer
+  FT_Error err;
+  if(IsSDF())
+  {
+    err = FT_Load_Glyph(face, index, FT_LOAD_NO_HINTING);
+#ifdef FG_FREETYPE_SDF
+    if(!err && face->glyph->outline.n_points > 0) // Empty outlines have no distance field to speak of
+      err = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF);
+#endif
+  }
+  else
+    err = FT_Load_Glyph(face, index, FT_LOAD_RENDER | FT_LOAD_FORCE_AUTOHINT | _ftaa(aa));
 
-  return &g;
+  if(err != 0)
+    return false;
+
+  FT_Bitmap& gbmp     = face->glyph->bitmap;
+  const float FT_COEF = (1.0f / 64.0f);
+  out.width           = (gbmp.pixel_mode == FT_PIXEL_MODE_LCD) ? (gbmp.width / 3) : gbmp.width;
+  out.height          = gbmp.rows;
+
+  // SDF glyphs are shared by every size, so they keep the metrics they were rendered with and are scaled when used
+  Glyph& g           = out.glyph;
+  FG_Vec invdpiscale = IsSDF() ? FG_Vec{ 1.0f, 1.0f } : FG_Vec{ Backend::BASE_DPI / dpi.x, Backend::BASE_DPI / dpi.y };
+  g                  = Glyph{};
+  g.page             = -1;
+  g.advance          = (face->glyph->advance.x * FT_COEF * invdpiscale.x);
+  g.bearing.x        = (face->glyph->metrics.horiBearingX * FT_COEF * invdpiscale.x);
+  g.bearing.y        = (face->glyph->metrics.horiBearingY * FT_COEF * invdpiscale.y);
+  g.width            = static_cast<float>(out.width);
+  g.height           = static_cast<float>(out.height);
+
+  if(IsSDF()) // The distance field extends past the outline, so the bitmap's own offset has to be used
+  {
+    g.bearing.x = static_cast<float>(face->glyph->bitmap_left);
+    g.bearing.y = static_cast<float>(face->glyph->bitmap_top);
+  }
+
+  const size_t stride = size_t(_channels) * out.width;
+  out.pixels.resize(stride * out.height);
+  if(!out.pixels.empty())
+    _blit(gbmp, out.pixels.data(), stride, out.width);
+  return true;
 }
 
-Glyph* Font::RenderGlyph(Context* context, char32_t codepoint)
+// Packs a rasterized glyph into the staging atlas and tells every context which part of the page changed
+Glyph* Font::_place(uint32_t index, const RasterGlyph& raster)
 {
-  auto iter = kh_get_glyphmap(_glyphs, codepoint);
-  if(iter < kh_end(_glyphs) && kh_exist(_glyphs, iter) && context->CheckGlyph(codepoint))
-    return &kh_val(_glyphs, iter);
-
-  auto g = LoadGlyph(codepoint);
-  if(!g)
+  int r;
+  auto iter = kh_put_glyphmap(_glyphs, index, &r);
+  if(r < 0)
     return nullptr;
 
-  // if this throws an error, remove it as a possible renderable codepoint
-  if(FT_Load_Char(_face, codepoint, FT_LOAD_RENDER | FT_LOAD_FORCE_AUTOHINT | _ftaa(aa)) != 0)
+  Glyph& g = kh_val(_glyphs, iter);
+  g        = raster.glyph;
+  g.page   = -1; // Must be set before _allocate, which can evict pages and every glyph on them
+
+  if(raster.width > 0 && raster.height > 0)
   {
-    (*_backend->_log)(_backend->_root, FG_Level_ERROR, "codepoint %i in %s failed to load.", codepoint,
-                      _path.u8string().c_str());
-    return nullptr;
-  }
+    int x = 0;
+    int y = 0;
 
-  FT_Bitmap& gbmp = _face->glyph->bitmap;
-  uint32_t width  = (gbmp.pixel_mode == FT_PIXEL_MODE_LCD) ? (gbmp.width / 3) : gbmp.width;
+    // Reserve one extra pixel on each glyph's top and left side so linear filtering never picks up a neighbor
+    g.page = _allocate(raster.width + 1, raster.height + 1, x, y);
+    if(g.page < 0)
+    {
+      (*_backend->_log)(_backend->_root, FG_Level_ERROR, "glyph %u in %s is too large for the glyph atlas.", index,
+                        _path.u8string().c_str());
+      kh_del_glyphmap(_glyphs, iter);
+      return nullptr;
+    }
+    ++x;
+    ++y;
 
-  // Get the texture from our context, creating it if necessary
-  GLuint tex = context->GetFontTexture(this);
-  _enforceantialias(_ftaa(aa));
-  std::unique_ptr<uint8_t[]> buf(new uint8_t[width * 4 * gbmp.rows]);
+    auto& page          = _pages[g.page];
+    const size_t stride = size_t(_channels) << page.power;
+    const size_t row    = size_t(_channels) * raster.width;
+    page.used           = ++_tick;
+    g.uv                = { float(x), float(y), float(x + raster.width), float(y + raster.height) };
 
-  switch(gbmp.pixel_mode) // Now we render the glyph to our next available buffer
+    for(uint32_t i = 0; i < raster.height; ++i)
+      memcpy(page.staging.data() + ((y + i) * stride) + (x * _channels), raster.pixels.data() + (i * row), row);
+    for(auto c : _contexts)
+      c->DirtyFont(this, g.page, g.uv);
+  }
+  return &g;
+}
+
+// Converts a rendered glyph bitmap to the atlas format. LCD glyphs are stored as RGBA, everything else as one coverage
+// byte per pixel.
+void Font::_blit(const FT_Bitmap& gbmp, uint8_t* base, size_t stride, uint32_t width) const
+{
+  switch(gbmp.pixel_mode)
   {
   case FT_PIXEL_MODE_LCD:
     for(uint32_t i = 0; i < gbmp.rows; ++i)
     {
       uint8_t* src = gbmp.buffer + (i * gbmp.pitch);
-      uint8_t* dst = buf.get() + (4 * width * i);
-      for(uint32_t j = 0; j < g->width; ++j) // RGBA
+      uint8_t* dst = base + (stride * i);
+      for(uint32_t j = 0; j < width; ++j) // RGBA
       {
         *dst++ = src[0];
         *dst++ = src[1];
@@ -389,207 +645,466 @@ Glyph* Font::RenderGlyph(Context* context, char32_t codepoint)
     for(uint32_t i = 0; i < gbmp.rows; ++i)
     {
       uint8_t* src = gbmp.buffer + (i * gbmp.pitch);
-      uint8_t* dst = buf.get() + (4 * width * i);
-      for(uint32_t j = 0; j < gbmp.width; ++j) // RGBA
-      {
-        uint8_t v = *src++;
-        // v         = (uint8_t)(powf(v / 255.0f, (1.0f / 2.2f)) * 255.0f);
-        *dst++ = v; // premultiply alpha
-        *dst++ = v;
-        *dst++ = v;
-        *dst++ = v;
-      }
+      uint8_t* dst = base + (stride * i);
+      for(uint32_t j = 0; j < gbmp.width; ++j, dst += _channels)
+        memset(dst, *src++, _channels); // premultiply alpha
     }
     break;
   case FT_PIXEL_MODE_MONO:
     for(uint32_t i = 0; i < gbmp.rows; ++i)
     {
-      uint8_t* src  = gbmp.buffer + (i * gbmp.pitch);
-      uint32_t* dst = reinterpret_cast<uint32_t*>(buf.get() + (4 * width * i));
+      uint8_t* src = gbmp.buffer + (i * gbmp.pitch);
+      uint8_t* dst = base + (stride * i);
 
-      for(uint32_t j = 0; j < gbmp.width; ++j)
-        dst[j] = (src[j / 8] & (0x80 >> (j & 7))) ? 0xFFFFFFFF : 0x00000000;
+      for(uint32_t j = 0; j < gbmp.width; ++j, dst += _channels)
+        memset(dst, (src[j / 8] & (0x80 >> (j & 7))) ? 0xFF : 0x00, _channels);
     }
     break;
-  default: return nullptr;
   }
+}
+
+void Font::Prewarm(const char32_t* codepoints, size_t count)
+{
+  if(!_face)
+    return;
+
+  // Workers open their own face on the shared font data, which only works for scalable fonts
+  const bool async = (_face->face_flags & FT_FACE_FLAG_SCALABLE) != 0;
+  std::vector<uint32_t> jobs;
+  std::vector<std::vector<char32_t>> fallback(_fallbacks.size());
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    uint32_t index = FT_Get_Char_Index(_face, codepoints[i]);
+    if(!index) // Don't fill the atlas with copies of the missing glyph box
+    {
+      if(Font* f = FindFallback(codepoints[i]))
+        fallback[std::find(_fallbacks.begin(), _fallbacks.end(), f) - _fallbacks.begin()].push_back(codepoints[i]);
+      continue;
+    }
+    if(kh_get_glyphmap(_atlas->_glyphs, index) != kh_end(_atlas->_glyphs) ||
+       kh_get_codeset(_atlas->_missing, index) != kh_end(_atlas->_missing))
+      continue;
 
-  glBindTexture(GL_TEXTURE_2D, tex);
-  _backend->LogError("glBindTexture");
-  glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(g->uv.left), static_cast<GLint>(g->uv.top), width, gbmp.rows,
-                  GL_RGBA, GL_UNSIGNED_BYTE, buf.get());
-  _backend->LogError("glTexSubImage2D");
-  glBindTexture(GL_TEXTURE_2D, 0);
-  _backend->LogError("glBindTexture");
+    if(!async)
+      LoadGlyph(index);
+    else
+    {
+      int r;
+      kh_put_codeset(_atlas->_queued, index, &r);
+      if(r > 0)
+        jobs.push_back(index);
+    }
+  }
 
-  context->AddGlyph(codepoint);
-  return &kh_val(_glyphs, iter);
+  if(!jobs.empty())
+    _backend->_workers.Queue(_atlas, jobs.data(), jobs.size());
+  for(size_t i = 0; i < fallback.size(); ++i)
+    if(!fallback[i].empty())
+      _fallbacks[i]->Prewarm(fallback[i].data(), fallback[i].size());
 }
 
-float Font::GetKerning(char32_t prev, char32_t cur)
+// A null glyph means the worker failed, which still has to be recorded so the glyph can be queued again later
+void Font::_deliver(uint32_t index, RasterGlyph* glyph)
 {
-  if(!_haskerning)
-    return 0.0f;
+  std::lock_guard<std::mutex> lock(_readylock);
+  if(glyph)
+    _ready.emplace_back(index, std::move(*glyph));
+  else
+    _failed.push_back(index);
+  _hasready.store(true, std::memory_order_release);
+}
 
-  FT_Vector kerning;
-  FT_Get_Kerning(_face, prev, cur, FT_KERNING_DEFAULT, &kerning);
-  return kerning.x * (1.0f / 64.0f); // this would return .y for vertical layouts
+void Font::_collect()
+{
+  std::vector<std::pair<uint32_t, RasterGlyph>> ready;
+  std::vector<uint32_t> failed;
+  {
+    std::lock_guard<std::mutex> lock(_readylock);
+    ready.swap(_ready);
+    failed.swap(_failed);
+    _hasready.store(false, std::memory_order_relaxed);
+  }
+
+  // Failed glyphs are left for LoadGlyph, which reports the error if they're ever drawn
+  for(auto c : failed)
+  {
+    auto q = kh_get_codeset(_queued, c);
+    if(q != kh_end(_queued))
+      kh_del_codeset(_queued, q);
+  }
+
+  for(auto& r : ready)
+  {
+    auto q = kh_get_codeset(_queued, r.first);
+    if(q != kh_end(_queued))
+      kh_del_codeset(_queued, q);
+    if(kh_get_glyphmap(_glyphs, r.first) == kh_end(_glyphs))
+      _place(r.first, r.second);
+  }
+}
+
+void Font::_addpage(int power)
+{
+  _pages.emplace_back();
+  auto& page = _pages.back();
+  page.power = power;
+  page.used  = _tick;
+  page.staging.resize(size_t(_channels) << (power * 2), 0);
+  page.skyline.push_back(Skyline{ 0, 0, 1 << power });
+}
+
+// Doubles the size of a page. Glyphs keep their pixel positions, so contexts only need to reupload everything.
+void Font::_grow(Page& page)
+{
+  const size_t oldstride = size_t(_channels) << page.power;
+  const int olddim       = 1 << page.power;
+  ++page.power;
+  const size_t stride = size_t(_channels) << page.power;
+
+  std::vector<uint8_t> staging(stride << page.power, 0);
+  for(int i = 0; i < olddim; ++i)
+    memcpy(staging.data() + (i * stride), page.staging.data() + (i * oldstride), oldstride);
+  page.staging.swap(staging);
+
+  // The new space to the right of the old page is empty all the way to the top
+  if(page.skyline.back().y == 0)
+    page.skyline.back().width += olddim;
+  else
+    page.skyline.push_back(Skyline{ olddim, 0, olddim });
+
+  (*_backend->_log)(_backend->_root, FG_Level_DEBUG, "Glyph atlas of %s grew to %ix%i (%zu bytes per context)",
+                    _path.u8string().c_str(), 1 << page.power, 1 << page.power, GetAtlasBytes());
 }
 
-FG_Vec Font::CalcTextDim(const char32_t* text, const FG_Vec& maxdim, float curlineheight, float letterspacing,
-                         FG_BreakStyle breakstyle)
+// Finds room for a glyph, growing, adding or evicting pages as necessary, and returns the page it ended up on
+int Font::_allocate(int width, int height, int& x, int& y)
 {
-  FG_Vec dest       = { 0, 0 };
-  bool dobreak      = false;
-  char32_t last     = 0;
-  float lastadvance = 0;
-  FG_Rect box       = { 0, 0, 0, 0 };
-  FG_Vec cursor     = { 0, !lineheight ? 0 : ((curlineheight / lineheight) * _ascender) };
+  if(width > (1 << MAX_PAGE_POWER) || height > (1 << MAX_PAGE_POWER))
+    return -1;
 
-  float width = 0.0f;
-  while(*text != 0)
+  for(;;)
   {
-    _getchar(text++, maxdim.x, breakstyle, curlineheight, letterspacing, cursor, box, last, lastadvance, dobreak);
-    if(box.right > dest.x)
-      dest.x = box.right;
+    for(size_t i = 0; i < _pages.size(); ++i)
+      if(_pack(_pages[i], width, height, x, y))
+        return static_cast<int>(i);
+
+    if(_pages.size() == 1 && _pages[0].power < MAX_PAGE_POWER)
+      _grow(_pages[0]);
+    else if(_pages.size() < MAX_PAGES)
+      _addpage(MAX_PAGE_POWER);
+    else
+    {
+      int lru = 0;
+      for(int i = 1; i < MAX_PAGES; ++i)
+        if(_pages[i].used < _pages[lru].used)
+          lru = i;
+      _evict(lru);
+      return _pack(_pages[lru], width, height, x, y) ? lru : -1;
+    }
   }
-  dest.y = cursor.y - _descender;
-  return dest;
 }
 
-float Font::GetLineWidth(const char32_t*& text, float maxwidth, FG_BreakStyle breakstyle, float letterspacing)
+// Empties a page and forgets every glyph on it, so they get rasterized again the next time they're needed
+void Font::_evict(int page)
 {
-  bool dobreak      = false;
-  char32_t last     = 0;
-  float lastadvance = 0;
-  FG_Rect box       = { 0, 0, 0, 0 };
-  FG_Vec cursor     = { 0, 0 };
-  float width       = 0.0f;
-  while(*text != 0 && !dobreak)
-    _getchar(text++, maxwidth, breakstyle, 0.0f, letterspacing, cursor, box, last, lastadvance, dobreak);
-  return box.right;
+  for(auto c : _contexts)
+    c->EvictFontPage(this, page);
+
+  for(khiter_t i = 0; i < kh_end(_glyphs); ++i)
+    if(kh_exist(_glyphs, i) && kh_val(_glyphs, i).page == page)
+      kh_del_glyphmap(_glyphs, i);
+
+  auto& p         = _pages[page];
+  const float dim = static_cast<float>(1 << p.power);
+  std::fill(p.staging.begin(), p.staging.end(), 0);
+  p.skyline.clear();
+  p.skyline.push_back(Skyline{ 0, 0, 1 << p.power });
+
+  for(auto c : _contexts)
+    c->DirtyFont(this, page, FG_Rect{ 0, 0, dim, dim });
+
+  (*_backend->_log)(_backend->_root, FG_Level_DEBUG, "Evicted glyph atlas page %i of %s", page,
+                    _path.u8string().c_str());
 }
 
-bool Font::_isspace(int c) // We have to make our own isspace implementation because the standard isspace() explodes if
-                           // you feed it unicode characters.
+// Bottom-left skyline packing: the glyph goes wherever its top edge ends up lowest, preferring narrower gaps on ties.
+bool Font::_pack(Page& page, int width, int height, int& x, int& y)
 {
-  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+  const int dim = 1 << page.power;
+  int best      = -1;
+  int besty     = dim;
+  int bestwidth = dim + 1;
+
+  for(size_t i = 0; i < page.skyline.size(); ++i)
+  {
+    if(page.skyline[i].x + width > dim)
+      break;
+
+    // The glyph has to sit on top of the highest node it would cover
+    int top  = 0;
+    int left = width;
+    for(size_t j = i; left > 0 && j < page.skyline.size(); ++j)
+    {
+      top = std::max(top, page.skyline[j].y);
+      left -= page.skyline[j].width;
+    }
+
+    if(top + height <= dim && (top < besty || (top == besty && page.skyline[i].width < bestwidth)))
+    {
+      best      = static_cast<int>(i);
+      besty     = top;
+      bestwidth = page.skyline[i].width;
+    }
+  }
+
+  if(best < 0)
+    return false;
+
+  x = page.skyline[best].x;
+  y = besty;
+
+  // Raise the skyline over the glyph, then trim or remove the nodes it now covers
+  page.skyline.insert(page.skyline.begin() + best, Skyline{ x, y + height, width });
+  for(size_t i = best + 1; i < page.skyline.size();)
+  {
+    auto& node = page.skyline[i];
+    int shrink = (x + width) - node.x;
+    if(shrink <= 0)
+      break;
+    if(node.width <= shrink)
+      page.skyline.erase(page.skyline.begin() + i);
+    else
+    {
+      node.x += shrink;
+      node.width -= shrink;
+      break;
+    }
+  }
+
+  for(size_t i = 0; i + 1 < page.skyline.size();)
+  {
+    if(page.skyline[i].y == page.skyline[i + 1].y)
+    {
+      page.skyline[i].width += page.skyline[i + 1].width;
+      page.skyline.erase(page.skyline.begin() + i + 1);
+    }
+    else
+      ++i;
+  }
+
+  return true;
+}
+
+size_t Font::GetAtlasBytes() const
+{
+  size_t bytes = 0;
+  for(auto& p : _atlas->_pages)
+    bytes += p.staging.size();
+  return bytes;
 }
 
-Glyph* Font::_getchar(const char32_t* text, float maxwidth, FG_BreakStyle breakstyle, float curlineheight,
-                      float letterspacing, FG_Vec& cursor, FG_Rect& box, char32_t& last, float& lastadvance, bool& dobreak)
+void Font::AddContext(Context* context) { _contexts.push_back(context); }
+
+void Font::RemoveContext(Context* context)
 {
-  cursor.x += lastadvance;
-  char32_t c = *text;
-  auto iter  = kh_get_glyphmap(_glyphs, c);
-  Glyph* g;
-  if((iter >= kh_end(_glyphs) || !kh_exist(_glyphs, iter)) && (c != '\n' && c != '\r'))
+  for(size_t i = 0; i < _contexts.size(); ++i)
+    if(_contexts[i] == context)
+    {
+      _contexts[i] = _contexts.back();
+      _contexts.pop_back();
+      return;
+    }
+}
+
+float Font::GetKerning(char32_t prev, char32_t cur)
+{
+  if(!_haskerning || !prev)
+    return 0.0f;
+
+  int32_t kerning;
+  int row = _kernslot(prev);
+  int col = _kernslot(cur);
+  if(row >= 0 && col >= 0)
   {
-    g = LoadGlyph(c);
-    if(!g)
+    auto& k = _kernrows[row];
+    if(k.empty()) // Rows are filled the first time they're needed, so fonts only pay for the characters they draw
     {
-      lastadvance = 0;
-      last        = c;
-      return 0; // Note: Bad glyphs usually just have 0 width, so we don't have to check for them.
+      k.resize(KERN_SLOTS, 0);
+      for(char32_t c = 0x20; c < 0x460; ++c)
+        if(_kernslot(c) >= 0)
+          k[_kernslot(c)] = static_cast<int16_t>(_loadkerning(prev, c));
     }
+    kerning = k[col];
   }
   else
-    g = &kh_val(_glyphs, iter);
+  {
+    if(kh_size(_kernpairs) >= MAX_KERN_PAIRS)
+      kh_clear_kernmap(_kernpairs);
 
-  float advance   = 0.0f;
-  box.left        = cursor.x;
-  box.top         = cursor.y;
-  box.right       = cursor.x;
-  box.bottom      = cursor.y;
+    int r;
+    auto iter = kh_put_kernmap(_kernpairs, (uint64_t(prev) << 32) | cur, &r);
+    if(r > 0)
+      kh_val(_kernpairs, iter) = _loadkerning(prev, cur);
+    kerning = (r < 0) ? _loadkerning(prev, cur) : kh_val(_kernpairs, iter);
+  }
 
-  if(c != '\n' && c != '\r')
+  return kerning * (1.0f / 64.0f) * _scale; // this would return .y for vertical layouts
+}
+
+// Maps Latin-1, Greek and Cyrillic to rows and columns of the dense kerning table
+int Font::_kernslot(char32_t c)
+{
+  if(c >= 0x20 && c < 0x100)
+    return c - 0x20;
+  if(c >= 0x370 && c < 0x400)
+    return 224 + (c - 0x370);
+  if(c >= 0x400 && c < 0x460)
+    return 368 + (c - 0x400);
+  return -1;
+}
+
+int32_t Font::_loadkerning(char32_t prev, char32_t cur)
+{
+  FT_UInt left  = FT_Get_Char_Index(_face, prev);
+  FT_UInt right = FT_Get_Char_Index(_face, cur);
+  FT_Vector kerning;
+  _activate(); // Kerning is scaled to the active size
+  if(!left || !right || FT_Get_Kerning(_face, left, right, FT_KERNING_DEFAULT, &kerning) != 0)
+    return 0;
+  return static_cast<int32_t>(kerning.x);
+}
+
+void Font::Measure(void* font, char32_t prev, char32_t cur, float& advance, float& kerning)
+{
+  // Breaking a line only needs advances, so nothing is rasterized until the text is actually drawn
+  auto f  = static_cast<Font*>(font);
+  advance = (cur == '\n' || cur == '\r') ? 0.0f : f->GetCharAdvance(cur);
+  kerning = f->GetKerning(prev, cur);
+}
+
+std::shared_ptr<const ShapedRun> Font::Shape(const char32_t* text, size_t len)
+{
+  std::u32string key(text, len);
+  auto cached = _runindex.find(key);
+  if(cached != _runindex.end())
   {
-    advance = g->advance + letterspacing + GetKerning(last, c);
-    box.left += g->bearing.x;
-    box.top -= g->bearing.y;
-    box.right  = box.left + g->width;
-    box.bottom = box.top + g->height;
+    _runs.splice(_runs.begin(), _runs, cached->second);
+    return cached->second->second;
   }
 
-  dobreak = c == '\n';
-  if(!dobreak && (breakstyle != FG_BreakStyle_NONE) && maxwidth >= 0.0f && box.right > maxwidth)
-    dobreak = true;
-  if(!dobreak && (breakstyle == FG_BreakStyle_WORD) && _isspace(last) && !_isspace(c) && maxwidth >= 0.0f)
+  auto run = std::make_shared<ShapedRun>();
+  run->x.push_back(0.0f);
+  if(_hbfont && len > 0)
   {
-    float right         = cursor.x + advance;
-    const char32_t* cur = ++text; // we can increment cur by one, because if our current character had been over the end, it
-                                  // would have been handled above.
-    while(*cur != 0 && !isspace(*cur))
+    hb_buffer_clear_contents(_hbbuffer);
+    hb_buffer_add_utf32(_hbbuffer, reinterpret_cast<const uint32_t*>(text), static_cast<int>(len), 0,
+                        static_cast<int>(len));
+    hb_buffer_guess_segment_properties(_hbbuffer);
+    // Until there's bidi support, every run is shaped left to right. Arabic and Hebrew would otherwise come back in
+    // visual order with descending clusters, which GetIndex, GetPos and drawing all assume can't happen.
+    hb_buffer_set_direction(_hbbuffer, HB_DIRECTION_LTR);
+    _activate(); // HarfBuzz measures glyphs with whatever size the face has active
+    hb_shape(_hbfont, _hbbuffer, nullptr, 0);
+
+    unsigned int count;
+    hb_glyph_info_t* info    = hb_buffer_get_glyph_infos(_hbbuffer, &count);
+    hb_glyph_position_t* pos = hb_buffer_get_glyph_positions(_hbbuffer, &count);
+    const float unit         = (1.0f / 64.0f) * _scale * Backend::BASE_DPI; // Same scaling LoadGlyph uses
+    FG_Vec scale             = { unit / dpi.x, unit / dpi.y };
+
+    run->glyphs.resize(count);
+    for(unsigned int i = 0; i < count; ++i)
     {
-      auto i = kh_get_glyphmap(_glyphs, c);
-      if(i >= kh_end(_glyphs) || !kh_exist(_glyphs, i))
+      auto& g   = run->glyphs[i];
+      g.font    = this;
+      g.index   = info[i].codepoint; // HarfBuzz replaces codepoints with glyph indices in place
+      g.cluster = info[i].cluster;
+      g.offset  = { pos[i].x_offset * scale.x, -pos[i].y_offset * scale.y }; // HarfBuzz's y axis points up
+      g.advance = pos[i].x_advance * scale.x;
+
+      // Glyph 0 means this font doesn't have the character. Fallback glyphs are placed by their own advance instead
+      // of being shaped again with the fallback font.
+      Font* fallback = (!g.index && g.cluster < len) ? FindFallback(text[g.cluster]) : nullptr;
+      if(fallback)
       {
-        Glyph* gword = &kh_val(_glyphs, i);
-        if(right + gword->bearing.x + gword->width > maxwidth)
-        {
-          dobreak = true;
-          break;
-        }
-        // cur[-1] is safe here because we incremented cur before entering this loop.
-        right += gword->advance + letterspacing + GetKerning(cur[-1], cur[0]);
+        g.font    = fallback;
+        g.index   = FT_Get_Char_Index(fallback->_face, text[g.cluster]);
+        g.offset  = { 0.0f, 0.0f };
+        g.advance = fallback->GetGlyphAdvance(g.index);
       }
-      ++cur;
+      run->x.push_back(run->x.back() + g.advance);
     }
   }
 
-  if(dobreak)
+  _runs.emplace_front(key, run);
+  _runindex.emplace(std::move(key), _runs.begin());
+  if(_runs.size() > MAX_RUNS)
   {
-    box.left -= cursor.x;
-    box.right -= cursor.x;
-    box.top += curlineheight;
-    box.bottom += curlineheight;
-    cursor.x = 0;
-    cursor.y += curlineheight;
+    _runindex.erase(_runs.back().first);
+    _runs.pop_back();
   }
+  return run;
+}
 
-  lastadvance = advance;
-  last        = c;
-  return g;
+const char32_t* TextLayout::LineEnd(size_t line) const
+{
+  const char32_t* end = lines[line];
+  if(line + 1 < lines.size())
+    end = lines[line + 1];
+  else
+    while(*end)
+      ++end;
+
+  while(end > lines[line] && (end[-1] == '\n' || end[-1] == '\r'))
+    --end;
+  return end;
 }
-std::pair<size_t, FG_Vec> Font::GetIndex(const char32_t* text, float maxwidth, FG_BreakStyle breakstyle,
-                                         float curlineheight, float letterspacing, FG_Vec pos)
-{
-  std::pair<size_t, FG_Vec> cache = { 0, { 0, 0 } };
-  if(!text)
-    return cache;
-  bool dobreak      = false;
-  char32_t last     = 0;
-  float lastadvance = 0;
-  FG_Rect box       = { 0, 0, 0, 0 };
-  Glyph* g          = 0;
-  for(cache.first = 0; text[cache.first] != 0; ++cache.first)
-  {
-    std::pair<size_t, FG_Vec> lastcache = cache;
-    lastcache.second.x += lastadvance;
-    g = _getchar(text + cache.first, maxwidth, breakstyle, curlineheight, letterspacing, cache.second, box, last,
-                 lastadvance, dobreak);
-    if(pos.y <= cache.second.y + curlineheight && pos.x < cache.second.x + (g ? g->bearing.x + (g->width * 0.5f) : 0.0f))
-      return cache;             // we immediately terminate and return, WITHOUT adding the lastadvance on.
-    if(pos.y <= cache.second.y) // Too far! return our previous cache.
-      return lastcache;
-  }
-  cache.second.x +=
-    lastadvance; // We have to add the lastadvance on here because we left the loop at the end of the string.
-  return cache;
-}
-std::pair<size_t, FG_Vec> Font::GetPos(const char32_t* text, float maxwidth, FG_BreakStyle breakstyle, float curlineheight,
-                                       float letterspacing, size_t index)
-{
-  std::pair<size_t, FG_Vec> cache = { 0, { 0, 0 } };
-  if(!text)
-    return cache;
-  bool dobreak      = false;
-  char32_t last     = 0;
-  float lastadvance = 0;
-  FG_Rect box       = { 0, 0, 0, 0 };
-  for(cache.first = 0; cache.first < index && text[cache.first] != 0; ++cache.first)
-    _getchar(text + cache.first, maxwidth, breakstyle, curlineheight, letterspacing, cache.second, box, last, lastadvance,
-             dobreak);
-  cache.second.x += lastadvance;
-  return cache;
+
+std::pair<size_t, FG_Vec> Font::GetIndex(const TextLayout& layout, FG_Vec pos)
+{
+  if(layout.lines.empty())
+    return { 0, { 0, 0 } };
+
+  // Every line has the same height, so finding the line is a division instead of a search
+  size_t line = 0;
+  if(layout.lineheight > 0.0f && pos.y > 0.0f)
+    line = std::min(static_cast<size_t>(pos.y / layout.lineheight), layout.lines.size() - 1);
+
+  // Find the first glyph whose midpoint is past pos.x
+  auto& run   = *layout.runs[line];
+  size_t low  = 0;
+  size_t high = run.glyphs.size();
+  while(low < high)
+  {
+    size_t mid = (low + high) / 2;
+    if(pos.x < (run.x[mid] + run.x[mid + 1]) * 0.5f + mid * layout.letterspacing)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+
+  FG_Vec cursor = { run.x[low] + low * layout.letterspacing, line * layout.lineheight };
+  if(low < run.glyphs.size())
+    return { static_cast<size_t>(layout.lines[line] - layout.text) + run.glyphs[low].cluster, cursor };
+  return { static_cast<size_t>(layout.LineEnd(line) - layout.text), cursor };
+}
+
+std::pair<size_t, FG_Vec> Font::GetPos(const TextLayout& layout, size_t index)
+{
+  if(layout.lines.empty())
+    return { 0, { 0, 0 } };
+
+  index            = std::min(index, layout.length);
+  auto first       = std::upper_bound(layout.lines.begin(), layout.lines.end(), layout.text + index) - 1;
+  size_t line      = first - layout.lines.begin();
+  uint32_t cluster = static_cast<uint32_t>(index - (*first - layout.text));
+
+  auto& run    = *layout.runs[line];
+  size_t glyph = std::lower_bound(run.glyphs.begin(), run.glyphs.end(), cluster,
+                                  [](const ShapedGlyph& g, uint32_t c) { return g.cluster < c; }) -
+                 run.glyphs.begin();
+
+  FG_Vec cursor = { run.x[glyph] + glyph * layout.letterspacing, line * layout.lineheight };
+  return { std::min(index, static_cast<size_t>(layout.LineEnd(line) - layout.text)), cursor };
 }
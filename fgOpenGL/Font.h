@@ -8,12 +8,25 @@
 #include "compiler.h"
 #include "filesys.h"
 #include "khash.h"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 struct FT_FaceRec_;
+struct FT_SizeRec_;
+struct FT_Bitmap_;
+struct FT_LibraryRec_;
+struct hb_font_t;
+struct hb_buffer_t;
 
 namespace GL {
   class Backend;
   struct Context;
+  struct FontFile;
 
   // Internal Glyph object tracking an individual glyph
   struct Glyph
@@ -23,9 +36,44 @@ namespace GL {
     FG_Vec bearing;
     float width;
     float height;
+    int page; // Atlas page holding the glyph, or -1 if it has no pixels
   };
 
+  // A glyph that has been rasterized but not yet placed in the atlas. The pixels are already in the font's format.
+  struct RasterGlyph
+  {
+    Glyph glyph;
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> pixels;
+  };
+
+  struct Font;
+
+  // A glyph picked by HarfBuzz, positioned relative to the pen
+  struct ShapedGlyph
+  {
+    Font* font;       // Font the index belongs to, which is a fallback if the shaping font doesn't have the character
+    uint32_t index;   // Glyph index in the font, not a codepoint
+    uint32_t cluster; // Offset of the first character this glyph came from, relative to the start of the run
+    FG_Vec offset;
+    float advance;
+  };
+
+  struct ShapedRun
+  {
+    std::vector<ShapedGlyph> glyphs; // Always shaped left to right, so clusters never decrease
+    // Pen position before each glyph, plus one past the end, not counting letter spacing. Glyph i with letter spacing
+    // starts at x[i] + i * letterspacing, which lets hit-testing binary search a line.
+    std::vector<float> x;
+  };
+
+  struct TextLayout;
+
   KHASH_DECLARE(glyphmap, int, Glyph);
+  KHASH_DECLARE(codeset, int, char);
+  KHASH_DECLARE(kernmap, uint64_t, int32_t);
+  KHASH_DECLARE(fallbackmap, int, int);
 
   // Internal Font object
   struct Font : FG_Font
@@ -33,46 +81,155 @@ namespace GL {
     Font(Backend* backend, const char* font, int weight, bool italic, int psize, FG_AntiAliasing antialias,
          const FG_Vec& dpi);
     ~Font();
-    Glyph* LoadGlyph(char32_t codepoint);
+    // Rasterizes the glyph into the staging atlas if it isn't already there. Glyphs are keyed by glyph index, because
+    // that's what shaping produces. The metrics have to be scaled with GetAdvance or GetBounds of this font.
+    Glyph* LoadGlyph(uint32_t index);
+    // Advance of a glyph without rasterizing it, scaled like GetAdvance. These are the advances shaping produces.
+    float GetGlyphAdvance(uint32_t index);
+    // Advance of a character, taken from the first fallback that has it if this font doesn't
+    float GetCharAdvance(char32_t codepoint);
+    // Sets the fonts searched, in order, for characters this font doesn't have. Fallbacks must outlive any layout
+    // made with this font, but destroying one removes it from every chain it's in.
+    void SetFallback(Font* const* fonts, size_t count);
+    // Returns the first fallback that has the character, or null. Both the answer and each font's coverage are cached,
+    // so after the first miss this is a single hash lookup.
+    Font* FindFallback(char32_t codepoint);
+    // Shapes a single line of text. Results are kept in an LRU cache, so redrawing or relaying out the same text skips
+    // HarfBuzz entirely.
+    std::shared_ptr<const ShapedRun> Shape(const char32_t* text, size_t len);
+    // Queues glyphs to be rasterized by the backend's worker threads. Fonts that can't be opened by another thread are
+    // rasterized immediately instead.
+    void Prewarm(const char32_t* codepoints, size_t count);
+    // Places glyphs finished by the workers into the atlas. Must be called on the render thread.
+    inline void Collect()
+    {
+      if(_atlas->_hasready.load(std::memory_order_acquire))
+        _atlas->_collect();
+    }
     float GetKerning(char32_t prev, char32_t cur);
-    FG_Vec CalcTextDim(const char32_t* text, const FG_Vec& maxdim, float lineheight, float letterspacing,
-                       FG_BreakStyle breakstyle);
-    float GetLineWidth(const char32_t*& text, float maxwidth, FG_BreakStyle breakstyle, float letterspacing);
-    Glyph* RenderGlyph(Context* context, char32_t codepoint);
-    std::pair<size_t, FG_Vec> GetIndex(const char32_t* text, float maxwidth, FG_BreakStyle breakstyle, float lineheight,
-                                       float letterspacing, FG_Vec pos);
-    std::pair<size_t, FG_Vec> GetPos(const char32_t* text, float maxwidth, FG_BreakStyle breakstyle, float lineheight,
-                                     float letterspacing, size_t index);
-    inline int GetSizePower() const { return _curpower; }
+    // Measures a character for the LineBreaker, which passes the font as its context
+    static void Measure(void* font, char32_t prev, char32_t cur, float& advance, float& kerning);
+    std::pair<size_t, FG_Vec> GetIndex(const TextLayout& layout, FG_Vec pos);
+    std::pair<size_t, FG_Vec> GetPos(const TextLayout& layout, size_t index);
+    // SDF glyphs are shared by every size of the font, so their metrics are in atlas pixels and are only scaled to this
+    // font's size here. Everything else is stored at the size it's drawn at.
+    inline float GetAdvance(const Glyph& g) const { return g.advance * _metricscale.x; }
+    FG_Rect GetBounds(const Glyph& g, FG_Vec pen) const;
+    // Font whose atlas holds this font's glyphs. For SDF fonts this is the first size created from the same file, for
+    // everything else it's the font itself. Contexts keep their textures for the atlas font.
+    inline Font* GetAtlas() const { return _atlas; }
+    inline int GetPagePower(int page) const { return _atlas->_pages[page].power; }
     inline float GetAscender() const { return _ascender; }
+    // Changes whenever previously shaped runs stop being valid, so layouts know when they can't reuse them
+    inline uint64_t GetGeneration() const { return _generation; }
+    // CPU copy of an atlas page. Contexts upload the parts that changed instead of uploading glyphs one by one.
+    inline const uint8_t* GetStaging(int page) const { return _atlas->_pages[page].staging.data(); }
+    // Only LCD fonts need color, everything else is a single coverage channel
+    inline int GetChannels() const { return _channels; }
+    inline bool IsSDF() const { return (aa & FG_AntiAliasing_SDF) != 0; }
+    size_t GetAtlasBytes() const;
+    void AddContext(Context* context);
+    void RemoveContext(Context* context);
+
+    // The first page doubles in size until it hits MAX_PAGE_POWER, after which new pages are added. Once there are
+    // MAX_PAGES, the least recently drawn page is emptied to make room, so an atlas never grows past this bound.
+    static const int MAX_PAGE_POWER = 11;
+    static const int MAX_PAGES      = 4;
+    // SDF glyphs are rendered once at SDF_EM pixels per em and scaled to whatever size they're drawn at. SDF_SPREAD is
+    // how many pixels the distance field extends past the outline, which also limits how far text can be blurred.
+    static const int SDF_EM     = 48;
+    static const int SDF_SPREAD = 8;
+    // How many shaped lines each font remembers
+    static const size_t MAX_RUNS = 512;
+    // Kerning between Latin-1, Greek and Cyrillic characters is kept in a dense table. Other pairs go into a hash, which
+    // is cleared once it holds MAX_KERN_PAIRS.
+    static const int KERN_SLOTS        = 464;
+    static const size_t MAX_KERN_PAIRS = 65536;
 
   protected:
+    friend class GlyphWorkers;
+
     void _cleanup();
+    void _activate();
+    void _dropfallback(Font* font);
     void _enforceantialias(int ftaa);
-    int _ftaa(FG_AntiAliasing antialias);
-    bool _isspace(int c);
-    Glyph* _getchar(const char32_t* text, float maxwidth, FG_BreakStyle breakstyle, float lineheight, float letterspacing,
-                    FG_Vec& cursor, FG_Rect& box, char32_t& last, float& lastadvance, bool& dobreak);
+    int _ftaa(FG_AntiAliasing antialias) const;
+    // These three are called from worker threads, so they can only read members that never change after construction
+    bool _openface(FT_LibraryRec_* lib, FT_FaceRec_*& face) const;
+    bool _rasterize(FT_FaceRec_* face, uint32_t index, RasterGlyph& out) const;
+    void _deliver(uint32_t index, RasterGlyph* glyph);
+    void _collect();
+    Glyph* _place(uint32_t index, const RasterGlyph& raster);
+    static int _kernslot(char32_t c);
+    int32_t _loadkerning(char32_t prev, char32_t cur);
+    struct Skyline
+    {
+      int x;
+      int y;
+      int width;
+    };
+
+    struct Page
+    {
+      std::vector<uint8_t> staging;
+      std::vector<Skyline> skyline; // Top edge of the packed glyphs, sorted from left to right
+      int power;
+      uint64_t used; // Value of _tick the last time a glyph on this page was requested
+    };
+
+    void _blit(const FT_Bitmap_& bitmap, uint8_t* dest, size_t stride, uint32_t width) const;
+    void _addpage(int power);
+    void _grow(Page& page);
+    int _allocate(int width, int height, int& x, int& y);
+    void _evict(int page);
+    static bool _pack(Page& page, int width, int height, int& x, int& y);
 
     Backend* _backend;
     path _path;
+    FontFile* _file; // Shared with every other size of this font
     unsigned int _texture;
     struct FT_FaceRec_* _face;
+    struct FT_SizeRec_* _size; // Must be activated before anything that depends on the size uses _face
     float _ascender;
     float _descender;
     bool _haskerning;
     kh_glyphmap_t* _glyphs;
-    FG_Vec _cur;
-    FG_Vec _last; // holds the exclusion zone of the last texture size (if any)
-    int _curpower;
-    float _nexty;
+    std::vector<Page> _pages;
+    uint64_t _tick;
+    int _channels;
+    float _scale;        // Size of a rendered pixel when drawn, which is only ever different from 1 for SDF fonts
+    FG_Vec _metricscale; // Converts the metrics of shared SDF glyphs to this size, {1, 1} for everything else
+    Font* _atlas;
+    std::vector<Context*> _contexts; // Contexts holding a texture of this atlas, which get told about new glyphs
+    kh_codeset_t* _queued;           // Glyphs sent to the workers that haven't been collected yet
+    std::mutex _readylock;
+    std::vector<std::pair<uint32_t, RasterGlyph>> _ready; // Finished by the workers, guarded by _readylock
+    std::vector<uint32_t> _failed;                        // Couldn't be rasterized by a worker, guarded by _readylock
+    std::atomic<bool> _hasready;
+    std::vector<std::vector<int16_t>> _kernrows; // Dense kerning in 26.6 units, one row per slot, filled on first use
+    kh_kernmap_t* _kernpairs;
+    hb_font_t* _hbfont;
+    hb_buffer_t* _hbbuffer;
+    kh_codeset_t* _missing; // Glyphs that failed to load, so they aren't loaded and logged again on every frame
+    std::vector<Font*> _fallbacks;
+    std::vector<Font*> _users;      // Fonts that have this one as a fallback
+    kh_fallbackmap_t* _fallbackmap; // Slot in _fallbacks for characters this font doesn't have, or -1 if none do
+    uint64_t _generation;           // Bumped whenever the fallback chain changes
+    std::list<std::pair<std::u32string, std::shared_ptr<const ShapedRun>>> _runs; // Most recently used first
+    std::unordered_map<std::u32string, decltype(_runs)::iterator> _runindex;
   };
 
   struct TextLayout
   {
+    // Where a line ends, not counting the line break itself
+    const char32_t* LineEnd(size_t line) const;
+
     char32_t* text;
-    const char32_t** lines;
-    size_t n_lines;
+    size_t length; // Number of characters in text, not counting the null terminator
+    std::vector<const char32_t*> lines;                  // Start of each line in text
+    std::vector<std::shared_ptr<const ShapedRun>> runs; // Shaped glyphs of each line
+    Font* font;
+    uint64_t generation; // Font generation the runs were shaped with
     float letterspacing;
     float lineheight;
     FG_Rect area;
@@ -0,0 +1,144 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "GlyphWorkers.h"
+#include "Font.h"
+#include "ft2build.h"
+#include FT_FREETYPE_H
+#include <algorithm>
+
+using namespace GL;
+
+GlyphWorkers::GlyphWorkers() : _quit(false) {}
+
+GlyphWorkers::~GlyphWorkers()
+{
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    _quit = true;
+  }
+  _signal.notify_all();
+
+  for(auto w : _workers)
+  {
+    w->thread.join();
+    delete w;
+  }
+}
+
+void GlyphWorkers::Queue(Font* font, const uint32_t* indices, size_t count)
+{
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    if(_workers.empty())
+      _start();
+    for(size_t i = 0; i < count; ++i)
+      _jobs.push_back(Job{ font, indices[i] });
+  }
+  _signal.notify_all();
+}
+
+void GlyphWorkers::Forget(Font* font)
+{
+  std::unique_lock<std::mutex> lock(_lock);
+  if(_workers.empty())
+    return;
+
+  _jobs.erase(std::remove_if(_jobs.begin(), _jobs.end(), [font](const Job& j) { return j.font == font; }), _jobs.end());
+  _idle.wait(lock, [this, font]() {
+    return std::none_of(_workers.begin(), _workers.end(), [font](const Worker* w) { return w->current == font; });
+  });
+
+  // Workers close retired faces before taking another job, so a new font that happens to get the same address can
+  // never be handed a face opened for this one. Their faces read from the font's data, which may be unmapped as soon
+  // as the font is gone, so this waits until every worker has closed its face.
+  for(auto w : _workers)
+    w->retired.push_back(font);
+  _signal.notify_all();
+  _idle.wait(lock, [this]() {
+    return std::all_of(_workers.begin(), _workers.end(), [](const Worker* w) { return w->retired.empty(); });
+  });
+}
+
+// Keeps one core free for the render thread
+void GlyphWorkers::_start()
+{
+  unsigned int cores = std::thread::hardware_concurrency();
+  unsigned int count = std::min(MAX_WORKERS, std::max(1U, cores > 1 ? cores - 1 : 1));
+
+  for(unsigned int i = 0; i < count; ++i)
+  {
+    auto w    = new Worker{};
+    w->thread = std::thread(&GlyphWorkers::_run, this, w);
+    _workers.push_back(w);
+  }
+}
+
+// Workers never log, because the log callback isn't guaranteed to be thread-safe. Glyphs that fail here are simply
+// rasterized again on the render thread when they're drawn, which reports the error.
+void GlyphWorkers::_run(Worker* worker)
+{
+  FT_Library lib;
+  if(FT_Init_FreeType(&lib) != 0)
+    lib = nullptr;
+
+  std::vector<std::pair<Font*, FT_Face>> faces;
+  std::unique_lock<std::mutex> lock(_lock);
+
+  for(;;)
+  {
+    for(auto font : worker->retired)
+    {
+      auto i = std::find_if(faces.begin(), faces.end(), [font](const auto& f) { return f.first == font; });
+      if(i != faces.end())
+      {
+        if(i->second)
+          FT_Done_Face(i->second);
+        faces.erase(i);
+      }
+    }
+    if(!worker->retired.empty())
+    {
+      worker->retired.clear();
+      _idle.notify_all();
+    }
+
+    if(_quit)
+      break;
+    if(_jobs.empty())
+    {
+      _signal.wait(lock);
+      continue;
+    }
+
+    Job job = _jobs.front();
+    _jobs.pop_front();
+    worker->current = job.font;
+    lock.unlock();
+
+    auto i = std::find_if(faces.begin(), faces.end(), [&job](const auto& f) { return f.first == job.font; });
+    if(i == faces.end())
+    {
+      FT_Face face = nullptr;
+      if(lib)
+        job.font->_openface(lib, face);
+      faces.emplace_back(job.font, face); // Remember failures too, so they aren't retried for every glyph
+      i = faces.end() - 1;
+    }
+
+    RasterGlyph glyph;
+    bool success = i->second && job.font->_rasterize(i->second, job.index, glyph);
+    job.font->_deliver(job.index, success ? &glyph : nullptr);
+
+    lock.lock();
+    worker->current = nullptr;
+    _idle.notify_all();
+  }
+
+  lock.unlock();
+  for(auto& f : faces)
+    if(f.second)
+      FT_Done_Face(f.second);
+  if(lib)
+    FT_Done_FreeType(lib);
+}
@@ -0,0 +1,58 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#ifndef GL__GLYPH_WORKERS_H
+#define GL__GLYPH_WORKERS_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace GL {
+  struct Font;
+
+  // Rasterizes glyphs in the background. FreeType objects can't be shared between threads, so every worker opens its
+  // own FT_Library and its own FT_Face for each font it sees. Finished bitmaps are handed back to the font, and the render
+  // thread packs and uploads them the next time it collects. Workers are only started once something is queued.
+  class GlyphWorkers
+  {
+  public:
+    GlyphWorkers();
+    ~GlyphWorkers();
+    void Queue(Font* font, const uint32_t* indices, size_t count);
+    // Drops every queued job for this font and waits until no worker is using it or has a face open for it. Must be
+    // called before a font is destroyed.
+    void Forget(Font* font);
+
+    static const unsigned int MAX_WORKERS = 4;
+
+  private:
+    struct Job
+    {
+      Font* font;
+      uint32_t index;
+    };
+
+    struct Worker
+    {
+      std::thread thread;
+      Font* current;              // Font of the job being rasterized, or null
+      std::vector<Font*> retired; // Fonts that were destroyed, whose faces this worker still has to close
+    };
+
+    void _start();
+    void _run(Worker* worker);
+
+    std::mutex _lock;
+    std::condition_variable _signal; // Wakes workers when there's a new job or they need to quit
+    std::condition_variable _idle;   // Wakes Forget() when a worker finishes a job
+    std::deque<Job> _jobs;
+    std::vector<Worker*> _workers;
+    bool _quit;
+  };
+}
+
+#endif
@@ -10,7 +10,8 @@ using namespace GL;
 const float Layer::NEARZ = 0.2f;
 const float Layer::FARZ  = 100.0f;
 
-Layer::Layer(FG_Vec s, int f, Context* c) : context(c), opacity(0), initialized(false)
+Layer::Layer(FG_Vec s, int f, Context* c) :
+  context(c), opacity(0), initialized(false), valid(false), dirty{ 0, 0, 0, 0 }, redraw{ 0, 0, 0, 0 }
 {
   flags  = f;
   format = FG_Format_LAYER;
@@ -27,63 +28,44 @@ Layer::Layer(FG_Vec s, int f, Context* c) : context(c), opacity(0), initialized(
 
 Layer::~Layer() { Destroy(); }
 
+// Hands the render target back to the context's pool instead of deleting it
 void Layer::Destroy()
 {
   if(initialized)
-  {
-    glDeleteFramebuffers(1, &framebuffer);
-    context->GetBackend()->LogError("glDeleteFramebuffers");
-    GLuint texture = data.index;
-    glDeleteTextures(1, &texture);
-    context->GetBackend()->LogError("glDeleteTextures");
-  }
+    context->GetTargets().Release(target);
   initialized = false;
+  valid       = false;
 }
 
-// Creates the layer on the current openGL context based on the assetflags assigned to this layer object
+// Takes a render target from the context's pool that matches the size and assetflags of this layer
 bool Layer::Create()
 {
   if(initialized)
     return true;
 
-  auto backend = context->GetBackend();
-
-  glGenFramebuffers(1, &framebuffer);
-  backend->LogError("glGenFramebuffers");
-  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-  backend->LogError("glBindFramebuffer");
+  if(!context->GetTargets().Acquire(size.x, size.y, (flags & FG_AssetFlags_LINEAR) != 0, target))
+    return false;
 
-  GLuint texture;
-  glGenTextures(1, &texture);
-  backend->LogError("glGenTextures");
-  glBindTexture(GL_TEXTURE_2D, texture);
-  backend->LogError("glBindTexture");
+  data.index = target.texture;
+  valid      = false; // Pooled targets still hold whatever was drawn to them last
+  return true;
+}
 
-  if(flags & FG_AssetFlags_LINEAR)
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+void Layer::Invalidate(const FG_Rect* area)
+{
+  if(!valid)
+    return;
+  if(!area)
+    valid = false;
+  else if(dirty.right <= dirty.left || dirty.bottom <= dirty.top)
+    dirty = *area;
   else
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-
-  backend->LogError("glTexImage2D");
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  backend->LogError("glTexParameteri");
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  backend->LogError("glTexParameteri");
-
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
-  backend->LogError("glFramebufferTexture");
-
-  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
   {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    return false;
+    dirty.left   = std::min(dirty.left, area->left);
+    dirty.top    = std::min(dirty.top, area->top);
+    dirty.right  = std::max(dirty.right, area->right);
+    dirty.bottom = std::max(dirty.bottom, area->bottom);
   }
-
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  data.index = texture;
-  return true;
 }
 
 bool Layer::Update(float* tf, float o, FG_BlendState* b, Context* c)
@@ -94,14 +76,9 @@ bool Layer::Update(float* tf, float o, FG_BlendState* b, Context* c)
   if(b)
     blend = *b;
 
-  if(c != context) // If true we have to go BACK to the original window context, delete everything, then recreate it
+  if(c != context) // Framebuffers aren't shared between contexts, so we need a target from the new one
   {
-    auto cur = glfwGetCurrentContext();
-    if(context->GetWindow())
-      glfwMakeContextCurrent(context->GetWindow());
     Destroy();
-    glfwMakeContextCurrent(cur);
-
     context     = c;
     initialized = Create();
     return initialized;
@@ -143,18 +120,21 @@ void Layer::mat4x4_proj(mat4x4 M, float l, float r, float b, float t, float n, f
 // this layer's opacity to the alpha channel color modulation.
 int Layer::Composite()
 {
-  // Our quad mesh is the real pixel size of the layer, but has [0,1] UV coordinates.
+  // Our quad mesh is the real pixel size of the layer. The pooled texture can be larger than the layer, and we only
+  // rendered to its bottom left corner, so the UVs only cover that part.
+  const float uvx = static_cast<float>(size.x) / target.width;
+  const float uvy = static_cast<float>(size.y) / target.height;
   ImageVertex v[4];
 
   v[0].posUV[0] = 0;
   v[0].posUV[1] = 0;
   v[0].posUV[2] = 0;
-  v[0].posUV[3] = 1.0f;
+  v[0].posUV[3] = uvy;
 
   v[1].posUV[0] = size.x;
   v[1].posUV[1] = 0;
-  v[1].posUV[2] = 1.0f;
-  v[1].posUV[3] = 1.0f;
+  v[1].posUV[2] = uvx;
+  v[1].posUV[3] = uvy;
 
   v[2].posUV[0] = 0;
   v[2].posUV[1] = size.y;
@@ -163,7 +143,7 @@ int Layer::Composite()
 
   v[3].posUV[0] = size.x;
   v[3].posUV[1] = size.y;
-  v[3].posUV[2] = 1.0f;
+  v[3].posUV[2] = uvx;
   v[3].posUV[3] = 0;
 
   mat4x4 mvp;
@@ -6,6 +6,8 @@
 
 #include "backend.h"
 #include "linmath.h"
+#include "TargetPool.h"
+#include <vector>
 
 namespace GL {
   struct Context;
@@ -14,22 +16,29 @@ namespace GL {
   {
     Layer(FG_Vec s, int f, Context* c);
     ~Layer();
-    // Moves the texture to another window if necessary
+    // Moves the layer to another window if necessary, trading its render target for one from that window's pool
     bool Update(float* tf, float o, FG_BlendState* blend, Context* context);
     void Destroy();
     bool Create();
     int Composite();
+    // Marks part of a cached layer for redrawing, or the whole layer if area is null
+    void Invalidate(const FG_Rect* area);
 
     static void mat4x4_proj(mat4x4 M, float l, float r, float b, float t, float n, float f);
     static const float NEARZ;
     static const float FARZ;
+    static const int CACHED = 1; // Returned by Context::PushLayer when a cached layer needs no drawing
 
-    unsigned int framebuffer;
+    RenderTarget target;
     mat4x4 transform;
     mat4x4 proj;
     float opacity;
     Context* context;
     bool initialized;
+    bool valid;   // Framebuffer holds the result of the last draw, only tracked for FG_AssetFlags_CACHE_LAYER
+    FG_Rect dirty;                  // Area invalidated since the last draw started
+    FG_Rect redraw;                 // Area being drawn between PushLayer and PopLayer, in the layer's own coordinates
+    std::vector<FG_Rect> outerclip; // Clip stack of the target the layer was pushed on, restored by PopLayer
     FG_BlendState blend;
   };
 }
@@ -0,0 +1,207 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "LineBreak.h"
+
+using namespace GL;
+
+namespace {
+  // clang-format off
+  const BreakClass ASCII_CLASSES[128] = {
+    BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, // 0x00
+    BREAK_CM, BREAK_BA, BREAK_LF, BREAK_BK, BREAK_BK, BREAK_CR, BREAK_CM, BREAK_CM, // 0x08
+    BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, // 0x10
+    BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, BREAK_CM, // 0x18
+    BREAK_SP, BREAK_EX, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, //  !"#$%&'
+    BREAK_OP, BREAK_CL, BREAK_AL, BREAK_AL, BREAK_IS, BREAK_HY, BREAK_IS, BREAK_IS, // ()*+,-./
+    BREAK_NU, BREAK_NU, BREAK_NU, BREAK_NU, BREAK_NU, BREAK_NU, BREAK_NU, BREAK_NU, // 01234567
+    BREAK_NU, BREAK_NU, BREAK_IS, BREAK_IS, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_EX, // 89:;<=>?
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, // @A-G
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, // H-O
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, // P-W
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_OP, BREAK_AL, BREAK_CL, BREAK_AL, BREAK_AL, // XYZ[\]^_
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, // `a-g
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, // h-o
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, BREAK_AL, // p-w
+    BREAK_AL, BREAK_AL, BREAK_AL, BREAK_OP, BREAK_BA, BREAK_CL, BREAK_AL, BREAK_CM, // xyz{|}~
+  };
+  // clang-format on
+}
+
+LineBreaker::LineBreaker(const char32_t* text, size_t len, size_t base, float maxwidth, float letterspacing,
+                         FG_BreakStyle style, MEASURE measure, void* context) :
+  _text(text),
+  _len(len),
+  _base(base),
+  _maxwidth(maxwidth),
+  _letterspacing(letterspacing),
+  _style(style),
+  _measurefn(measure),
+  _context(context)
+{}
+
+BreakClass LineBreaker::Classify(char32_t c)
+{
+  if(c < 128)
+    return ASCII_CLASSES[c];
+
+  switch(c)
+  {
+  case 0x85:
+  case 0x2028:
+  case 0x2029: return BREAK_BK;
+  case 0x200B: return BREAK_ZW;
+  case 0xA0:
+  case 0x2007:
+  case 0x2011:
+  case 0x202F:
+  case 0x2060:
+  case 0xFEFF: return BREAK_GL;
+  case 0xAD:
+  case 0x1680:
+  case 0x2010:
+  case 0x2012:
+  case 0x2013:
+  case 0x3000: return BREAK_BA;
+  case 0xB4:
+  case 0x2C8:
+  case 0x2CC:
+  case 0x2DF: return BREAK_BB;
+  case 0xA1:
+  case 0xBF:
+  case 0x2018:
+  case 0x201C:
+  case 0x3008:
+  case 0x300A:
+  case 0x300C:
+  case 0x300E:
+  case 0x3010:
+  case 0xFF08:
+  case 0xFF3B:
+  case 0xFF5B: return BREAK_OP;
+  case 0x2019:
+  case 0x201D:
+  case 0x3001:
+  case 0x3002:
+  case 0x3009:
+  case 0x300B:
+  case 0x300D:
+  case 0x300F:
+  case 0x3011:
+  case 0xFF09:
+  case 0xFF0C:
+  case 0xFF0E:
+  case 0xFF3D:
+  case 0xFF5D: return BREAK_CL;
+  case 0xFF01:
+  case 0xFF1F: return BREAK_EX;
+  case 0x200D: return BREAK_CM;
+  }
+
+  if((c >= 0x2000 && c <= 0x2006) || (c >= 0x2008 && c <= 0x200A))
+    return BREAK_BA;
+  if((c >= 0x300 && c <= 0x36F) || (c >= 0x1AB0 && c <= 0x1AFF) || (c >= 0x1DC0 && c <= 0x1DFF) ||
+     (c >= 0x20D0 && c <= 0x20FF) || (c >= 0xFE00 && c <= 0xFE0F) || (c >= 0xFE20 && c <= 0xFE2F))
+    return BREAK_CM;
+  if((c >= 0x2E80 && c <= 0x2FFF) || (c >= 0x3040 && c <= 0x30FF) || (c >= 0x3400 && c <= 0x4DBF) ||
+     (c >= 0x4E00 && c <= 0x9FFF) || (c >= 0xAC00 && c <= 0xD7AF) || (c >= 0xF900 && c <= 0xFAFF) ||
+     (c >= 0xFF00 && c <= 0xFFEF) || (c >= 0x1F300 && c <= 0x1FAFF) || (c >= 0x20000 && c <= 0x3FFFD))
+    return BREAK_ID;
+  return BREAK_AL;
+}
+
+// Whether a line may break between a character of class prev and one of class cur. afterzw and afterop are set when
+// prev is a space that follows a ZW or an OP, since those rules look through spaces.
+bool LineBreaker::_canbreak(BreakClass prev, BreakClass cur, bool afterzw, bool afterop)
+{
+  if(cur == BREAK_SP || cur == BREAK_ZW) // LB7
+    return false;
+  if(afterzw) // LB8
+    return true;
+
+  switch(cur) // LB9, LB13: never break before these, even after a space
+  {
+  case BREAK_CM:
+  case BREAK_CL:
+  case BREAK_EX:
+  case BREAK_IS: return false;
+  default: break;
+  }
+
+  if(afterop || prev == BREAK_GL) // LB12, LB14
+    return false;
+  if(prev == BREAK_SP) // LB18
+    return true;
+  if(cur == BREAK_GL || cur == BREAK_BA || cur == BREAK_HY || prev == BREAK_BB) // LB12a, LB21
+    return false;
+
+  switch(prev)
+  {
+  case BREAK_AL:
+  case BREAK_NU: return cur != BREAK_AL && cur != BREAK_NU && cur != BREAK_OP; // LB23, LB28, LB30
+  case BREAK_HY: return cur != BREAK_NU;                     // LB25
+  case BREAK_IS: return cur != BREAK_NU && cur != BREAK_AL; // LB25, LB29
+  default: return true;                                      // LB31
+  }
+}
+
+void LineBreaker::_measure(size_t i)
+{
+  while(_base + _advances.size() <= i)
+  {
+    size_t j = _base + _advances.size();
+    float advance;
+    float kerning;
+    (*_measurefn)(_context, j > 0 ? _text[j - 1] : 0, _text[j], advance, kerning);
+    _advances.push_back(advance + _letterspacing);
+    _kerning.push_back(kerning);
+  }
+}
+
+size_t LineBreaker::Next(size_t start, float maxwidth)
+{
+  const bool wrap = _style != FG_BreakStyle_NONE && maxwidth >= 0.0f;
+  float width     = 0.0f;
+  size_t breakpos = start; // Last break opportunity on this line
+  BreakClass prev = BREAK_BK;
+  bool afterzw    = false;
+  bool afterop    = false;
+
+  for(size_t i = start; i < _len; ++i)
+  {
+    BreakClass cur = Classify(_text[i]);
+    switch(cur)
+    {
+    case BREAK_BK:
+    case BREAK_LF: return i + 1;
+    case BREAK_CR: return (i + 1 < _len && _text[i + 1] == '\n') ? i + 2 : i + 1;
+    default: break;
+    }
+
+    if(wrap)
+    {
+      if(i > start && _canbreak(prev, cur, afterzw, afterop))
+        breakpos = i;
+
+      _measure(i);
+      width += _advances[i - _base];
+      if(i > start)
+        width += _kerning[i - _base];
+
+      // Spaces are allowed to hang past the edge, and a line always keeps at least one character
+      if(width > maxwidth && cur != BREAK_SP && i > start)
+        return (_style == FG_BreakStyle_WORD && breakpos > start) ? breakpos : i;
+    }
+
+    if(cur == BREAK_SP)
+      prev = BREAK_SP;
+    else if(cur != BREAK_CM) // LB9: combining marks take on the class of what they're attached to
+    {
+      prev    = cur;
+      afterzw = cur == BREAK_ZW;
+      afterop = cur == BREAK_OP;
+    }
+  }
+
+  return _len;
+}
@@ -0,0 +1,69 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#ifndef GL__LINE_BREAK_H
+#define GL__LINE_BREAK_H
+
+#include "backend.h"
+#include <stddef.h>
+#include <vector>
+
+namespace GL {
+  // The subset of the UAX #14 line breaking classes the breaker distinguishes. Everything else is treated as AL.
+  enum BreakClass : uint8_t
+  {
+    BREAK_AL, // Alphabetic
+    BREAK_BK, // Mandatory break
+    BREAK_CR,
+    BREAK_LF,
+    BREAK_SP, // Space
+    BREAK_ZW, // Zero width space
+    BREAK_CM, // Combining mark
+    BREAK_GL, // Non-breaking glue
+    BREAK_BA, // Break after
+    BREAK_BB, // Break before
+    BREAK_HY, // Hyphen
+    BREAK_OP, // Opening punctuation
+    BREAK_CL, // Closing punctuation
+    BREAK_EX, // Exclamation or interrogation
+    BREAK_IS, // Infix numeric separator
+    BREAK_NU, // Numeric
+    BREAK_ID, // Ideographic
+  };
+
+  // Greedy line breaker that sweeps the text once. Each character is measured the first time the sweep reaches it, and
+  // the result is kept, so breaking a whole paragraph is linear in its length.
+  class LineBreaker
+  {
+  public:
+    // Returns the advance of cur and the kerning between prev and cur. prev is 0 at the start of the text.
+    typedef void (*MEASURE)(void* context, char32_t prev, char32_t cur, float& advance, float& kerning);
+
+    // Lines can only be requested starting at base or later. A negative maxwidth never wraps.
+    LineBreaker(const char32_t* text, size_t len, size_t base, float maxwidth, float letterspacing, FG_BreakStyle style,
+                MEASURE measure, void* context);
+    // Returns where the line after the one starting at start begins, or len if it's the last line
+    inline size_t Next(size_t start) { return Next(start, _maxwidth); }
+    // Same as Next, but wraps at maxwidth instead. Used to break a line again when it turns out to be too wide.
+    size_t Next(size_t start, float maxwidth);
+
+    static BreakClass Classify(char32_t c);
+
+  private:
+    static bool _canbreak(BreakClass prev, BreakClass cur, bool afterzw, bool afterop);
+    void _measure(size_t i);
+
+    const char32_t* _text;
+    size_t _len;
+    size_t _base;
+    float _maxwidth;
+    float _letterspacing;
+    FG_BreakStyle _style;
+    MEASURE _measurefn;
+    void* _context;
+    std::vector<float> _advances; // Advance plus letter spacing of each measured character, starting at _base
+    std::vector<float> _kerning;  // Kerning with the previous character, which doesn't apply at the start of a line
+  };
+}
+
+#endif
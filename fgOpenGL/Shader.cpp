@@ -6,6 +6,10 @@
 #include <string.h>
 #include <memory>
 
+namespace GL {
+  __KHASH_IMPL(uniform, , uint64_t, int, 1, kh_int64_hash_func, kh_int64_hash_equal);
+}
+
 using namespace GL;
 
 Shader::Shader(const Shader& copy) : _pixel(copy._pixel), _vertex(copy._vertex), _geometry(copy._geometry)
@@ -63,7 +67,7 @@ void Shader::compile(Backend* backend, GLuint program, const char* src, int type
   backend->LogError("glAttachShader");
 }
 
-GLuint Shader::Create(Backend* backend) const
+GLuint Shader::Create(Backend* backend, kh_uniform_s* uniforms) const
 {
   auto program = glCreateProgram();
   backend->LogError("glCreateProgram");
@@ -89,6 +93,22 @@ GLuint Shader::Create(Backend* backend) const
     glGetProgramInfoLog(program, l, &l, buffer.get());
     (backend->_log)(backend->_root, FG_Level_WARNING, "Validation failed: %s", buffer.get());
   }
+
+  // Resolve every parameter once here so drawing never has to look a uniform up by name
+  for(uint32_t i = 0; i < n_parameters; ++i)
+  {
+    GLint loc = -1;
+    if(parameters[i].name) // Names are optional for textures
+    {
+      loc = glGetUniformLocation(program, parameters[i].name);
+      backend->LogError("glGetUniformLocation");
+    }
+
+    int r;
+    auto iter = kh_put_uniform(uniforms, UniformKey(program, i), &r);
+    if(r >= 0)
+      kh_val(uniforms, iter) = loc;
+  }
   return program;
 }
 
@@ -98,27 +118,18 @@ void Shader::Destroy(Backend* backend, unsigned int shader) const
   backend->LogError("glDeleteProgram");
 }
 
-void Shader::SetUniform(Backend* backend, unsigned int shader, const char* name, GLenum type, float* data)
+void Shader::SetUniform(Context* context, int loc, GLenum type, float* data)
 {
+  auto backend = context->GetBackend();
   if(type >= GL_TEXTURE0 && type <= GL_TEXTURE31)
   {
-    if(name) // Names are optional for textures
-    {
-      auto loc = glGetUniformLocation(shader, name);
-      backend->LogError("glGetUniformLocation");
-      if(loc > 0)
-        type = GL_TEXTURE0 + loc - 1;
-    }
+    if(loc > 0)
+      type = GL_TEXTURE0 + loc - 1;
 
-    glActiveTexture(type);
-    backend->LogError("glActiveTexture");
-    glBindTexture(GL_TEXTURE_2D, *reinterpret_cast<GLuint*>(data));
-    backend->LogError("glBindTexture");
+    context->BindTexture(type - GL_TEXTURE0, *reinterpret_cast<GLuint*>(data));
   }
   else
   {
-    auto loc = glGetUniformLocation(shader, name);
-    backend->LogError("glGetUniformLocation");
     switch(type)
     {
     case GL_FLOAT_MAT2: glUniformMatrix2fv(loc, 1, GL_FALSE, data); break;
@@ -14,6 +14,10 @@ struct GLFWwindow;
 
 namespace GL {
   class Backend;
+  struct Context;
+
+  // Maps UniformKey(program, parameter index) to the uniform location in that program
+  KHASH_DECLARE(uniform, uint64_t, int);
 
   struct Shader : FG_Shader
   {
@@ -35,13 +39,17 @@ namespace GL {
            size_t n_parameters);
     ~Shader();
 
-    // Creates the shader in the current context
-    unsigned int Create(Backend* backend) const;
+    // Creates the shader in the current context and stores the location of each parameter in uniforms
+    unsigned int Create(Backend* backend, kh_uniform_s* uniforms) const;
     // Destroys the shader from the current context
     void Destroy(Backend* backend, unsigned int shader) const;
 
     static GLenum GetType(const FG_ShaderParameter& param);
-    static void SetUniform(Backend* backend, unsigned int shader, const char* name, GLenum type, float* data);
+    static void SetUniform(Context* context, int location, GLenum type, float* data);
+    static inline uint64_t UniformKey(unsigned int program, uint32_t index)
+    {
+      return (static_cast<uint64_t>(program) << 32) | index;
+    }
 
     Shader& operator=(const Shader& copy);
     Shader& operator=(Shader&& mov) noexcept;
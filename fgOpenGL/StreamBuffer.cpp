@@ -0,0 +1,131 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "BackendGL.h"
+#include "StreamBuffer.h"
+#include <string.h>
+
+using namespace GL;
+
+StreamBuffer::StreamBuffer(Backend* backend, GLsizeiptr capacity, bool sync) :
+  _backend(backend), _capacity(capacity), _head(0), _segment(0), _sync(sync)
+{
+  glGenBuffers(1, &_buffer);
+  _backend->LogError("glGenBuffers");
+  glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+  _backend->LogError("glBindBuffer");
+  glBufferData(GL_ARRAY_BUFFER, _capacity, nullptr, GL_STREAM_DRAW);
+  _backend->LogError("glBufferData");
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  _backend->LogError("glBindBuffer");
+}
+
+StreamBuffer::~StreamBuffer()
+{
+  for(auto& s : _segments)
+    glDeleteSync(s.fence);
+  glDeleteBuffers(1, &_buffer);
+  _backend->LogError("glDeleteBuffers");
+}
+
+GLintptr StreamBuffer::Write(const void* data, GLsizeiptr bytes, GLsizeiptr align, bool rewind)
+{
+  if(bytes > _capacity)
+    return -1;
+
+  GLintptr offset = ((_head + align - 1) / align) * align;
+  if(offset + bytes > _capacity || (rewind && offset > 0))
+  {
+    // Wrap around, fencing the part of this frame that sits at the end of the buffer. Without fences we can't tell what
+    // the GPU is done with, so the storage is orphaned instead. Nothing past _head has been written since the last
+    // orphan, which is why that only has to happen here.
+    if(_sync)
+      _fenceSegment();
+    else
+      _orphan();
+    _head = _segment = offset = 0;
+  }
+
+  if(_sync)
+  {
+    // Any older range we're about to overwrite has to be finished on the GPU, otherwise we orphan instead of waiting
+    for(size_t i = 0; i < _segments.size();)
+    {
+      auto& s = _segments[i];
+      if(s.begin >= offset + bytes || s.end <= offset)
+        ++i;
+      else if(_signaled(s.fence))
+      {
+        glDeleteSync(s.fence);
+        _segments.erase(_segments.begin() + i);
+      }
+      else
+      {
+        _orphan();
+        offset = 0;
+        break;
+      }
+    }
+  }
+
+  const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+  void* dest              = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes, access);
+  _backend->LogError("glMapBufferRange");
+
+  if(dest)
+  {
+    memcpy(dest, data, bytes);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    _backend->LogError("glUnmapBuffer");
+  }
+  else
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+    _backend->LogError("glBufferSubData");
+  }
+
+  _head = offset + bytes;
+  return offset;
+}
+
+void StreamBuffer::Fence()
+{
+  if(!_sync)
+    return;
+
+  _fenceSegment();
+
+  // Drop fences from the front that are already done so the list stays as short as the number of frames in flight
+  size_t n = 0;
+  while(n < _segments.size() && _signaled(_segments[n].fence))
+    glDeleteSync(_segments[n++].fence);
+  _segments.erase(_segments.begin(), _segments.begin() + n);
+}
+
+void StreamBuffer::_orphan()
+{
+  glBufferData(GL_ARRAY_BUFFER, _capacity, nullptr, GL_STREAM_DRAW);
+  _backend->LogError("glBufferData");
+
+  for(auto& s : _segments)
+    glDeleteSync(s.fence);
+  _segments.clear();
+  _head = _segment = 0;
+}
+
+void StreamBuffer::_fenceSegment()
+{
+  if(_head <= _segment)
+    return;
+
+  GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _backend->LogError("glFenceSync");
+  _segments.push_back({ fence, _segment, _head });
+  _segment = _head;
+}
+
+bool StreamBuffer::_signaled(GLsync fence)
+{
+  GLenum r = glClientWaitSync(fence, 0, 0);
+  return r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED;
+}
@@ -0,0 +1,52 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#ifndef GL__STREAM_BUFFER_H
+#define GL__STREAM_BUFFER_H
+
+#include "glad/gl.h"
+#include <vector>
+
+namespace GL {
+  class Backend;
+
+  // A large vertex buffer that is filled front to back and reused as a ring. Every frame's range is fenced, and a range
+  // is only written again once its fence has signaled. If the GPU is still reading it, the storage is orphaned instead,
+  // so uploads never wait on the GPU. Without sync objects the storage is orphaned every time the ring wraps around.
+  class StreamBuffer
+  {
+  public:
+    StreamBuffer(Backend* backend, GLsizeiptr capacity, bool sync);
+    ~StreamBuffer();
+    // Copies data into the buffer and returns the offset it was written at, which is always a multiple of align.
+    // Returns -1 if the data can't fit in the buffer. The buffer must already be bound to GL_ARRAY_BUFFER. If rewind is
+    // set, the data is always written at offset 0, for indexed draws that have no base vertex to offset them.
+    GLintptr Write(const void* data, GLsizeiptr bytes, GLsizeiptr align, bool rewind = false);
+    // Fences everything written since the last call. Should be called once per frame.
+    void Fence();
+    inline GLuint GetBuffer() const { return _buffer; }
+    inline GLsizeiptr GetCapacity() const { return _capacity; }
+
+  private:
+    struct Segment
+    {
+      GLsync fence;
+      GLintptr begin;
+      GLintptr end;
+    };
+
+    void _orphan();
+    void _fenceSegment();
+    bool _signaled(GLsync fence);
+
+    Backend* _backend;
+    GLuint _buffer;
+    GLsizeiptr _capacity;
+    GLintptr _head;
+    GLintptr _segment; // Start of the range that hasn't been fenced yet
+    std::vector<Segment> _segments;
+    bool _sync;
+  };
+}
+
+#endif
@@ -0,0 +1,124 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#include "BackendGL.h"
+#include "TargetPool.h"
+#include <assert.h>
+
+using namespace GL;
+
+TargetPool::TargetPool(Context* context) : _context(context), _bytes(0) {}
+
+// Can't delete anything here because the context might not be current, so the owner has to call Clear() first
+TargetPool::~TargetPool() { assert(_free.empty()); }
+
+bool TargetPool::Acquire(GLsizei width, GLsizei height, bool linear, RenderTarget& out)
+{
+  width  = Bucket(width);
+  height = Bucket(height);
+
+  for(size_t i = 0; i < _free.size(); ++i)
+  {
+    auto& t = _free[i].target;
+    if(t.width == width && t.height == height && t.linear == linear)
+    {
+      out = t;
+      _bytes -= GetBytes(t);
+      _free[i] = _free.back();
+      _free.pop_back();
+      return true;
+    }
+  }
+
+  return _create(width, height, linear, out);
+}
+
+void TargetPool::Release(const RenderTarget& target)
+{
+  _free.push_back(Entry{ target, 0 });
+  _bytes += GetBytes(target);
+}
+
+void TargetPool::Trim()
+{
+  size_t freed = 0;
+  for(size_t i = 0; i < _free.size();)
+  {
+    if(++_free[i].idle > MAX_IDLE_FRAMES)
+    {
+      _bytes -= GetBytes(_free[i].target);
+      _destroy(_free[i].target);
+      _free[i] = _free.back();
+      _free.pop_back();
+      ++freed;
+    }
+    else
+      ++i;
+  }
+
+  if(freed > 0)
+  {
+    auto backend = _context->GetBackend();
+    (*backend->_log)(backend->_root, FG_Level_DEBUG, "Freed %zu idle render targets, %zu bytes still pooled", freed,
+                     _bytes);
+  }
+}
+
+void TargetPool::Clear()
+{
+  for(auto& e : _free)
+    _destroy(e.target);
+  _free.clear();
+  _bytes = 0;
+}
+
+bool TargetPool::_create(GLsizei width, GLsizei height, bool linear, RenderTarget& out)
+{
+  auto backend = _context->GetBackend();
+  out.width    = width;
+  out.height   = height;
+  out.linear   = linear;
+
+  glGenFramebuffers(1, &out.framebuffer);
+  backend->LogError("glGenFramebuffers");
+  glBindFramebuffer(GL_FRAMEBUFFER, out.framebuffer);
+  backend->LogError("glBindFramebuffer");
+
+  glGenTextures(1, &out.texture);
+  backend->LogError("glGenTextures");
+  _context->ActiveTexture(0);
+  _context->BindTexture(0, out.texture);
+
+  if(linear)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+  backend->LogError("glTexImage2D");
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  backend->LogError("glTexParameteri");
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  backend->LogError("glTexParameteri");
+
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, out.texture, 0);
+  backend->LogError("glFramebufferTexture");
+
+  bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  backend->LogError("glBindFramebuffer");
+
+  if(!complete)
+    _destroy(out);
+  return complete;
+}
+
+void TargetPool::_destroy(const RenderTarget& target)
+{
+  auto backend = _context->GetBackend();
+  glDeleteFramebuffers(1, &target.framebuffer);
+  backend->LogError("glDeleteFramebuffers");
+  glDeleteTextures(1, &target.texture);
+  backend->LogError("glDeleteTextures");
+  // Deleted names can be handed out again
+  _context->InvalidateState();
+}
@@ -0,0 +1,61 @@
+// Copyright (c)2021 Fundament Software
+// For conditions of distribution and use, see copyright notice in "fgOpenGL.h"
+
+#ifndef GL__TARGET_POOL_H
+#define GL__TARGET_POOL_H
+
+#include "glad/gl.h"
+#include <vector>
+
+namespace GL {
+  struct Context;
+
+  // A framebuffer with a single color texture attached. The texture can be larger than the area actually rendered to,
+  // because sizes are rounded up to a bucket so targets of similar size can be swapped for each other.
+  struct RenderTarget
+  {
+    GLuint framebuffer;
+    GLuint texture;
+    GLsizei width;
+    GLsizei height;
+    bool linear;
+  };
+
+  // Per-context free list of render targets, so layers that come and go every frame don't reallocate GPU memory.
+  // Targets that haven't been used for MAX_IDLE_FRAMES calls to Trim() are deleted. Release() makes no GL calls, so it's
+  // safe to call while a different context is current, but Acquire(), Trim() and Clear() need this context.
+  class TargetPool
+  {
+  public:
+    explicit TargetPool(Context* context);
+    ~TargetPool();
+    bool Acquire(GLsizei width, GLsizei height, bool linear, RenderTarget& out);
+    void Release(const RenderTarget& target);
+    // Ages every pooled target and deletes the ones that have been idle too long. Should be called once per frame.
+    void Trim();
+    void Clear();
+    inline size_t GetBytes() const { return _bytes; }
+
+    static inline GLsizei Bucket(GLsizei x) { return !x ? BUCKET : ((x + BUCKET - 1) / BUCKET) * BUCKET; }
+    static inline size_t GetBytes(const RenderTarget& t) { return static_cast<size_t>(t.width) * t.height * 4; }
+
+    static const GLsizei BUCKET               = 64;
+    static const unsigned int MAX_IDLE_FRAMES = 120;
+
+  private:
+    struct Entry
+    {
+      RenderTarget target;
+      unsigned int idle;
+    };
+
+    bool _create(GLsizei width, GLsizei height, bool linear, RenderTarget& out);
+    void _destroy(const RenderTarget& target);
+
+    Context* _context;
+    std::vector<Entry> _free;
+    size_t _bytes; // Memory held by targets sitting in the pool, not counting ones handed out
+  };
+}
+
+#endif
@@ -0,0 +1,16 @@
+TXT(#version 110\n
+varying vec2 uv;\n
+varying vec4 color;\n
+
+uniform sampler2D texture;\n
+uniform float Blur;\n
+
+void main()\n
+{\n
+  // Every channel holds the linear distance to the outline, which sits at 0.5\n
+  float d = texture2D(texture, uv).r;\n
+  float w = (0.5 + Blur) * fwidth(d);\n
+  float a = smoothstep(0.5 - w, 0.5 + w, d) * color.a;\n
+  gl_FragColor = vec4(color.rgb * a, a);\n
+}\n
+)
@@ -0,0 +1,120 @@
+TXT(#version 110\n
+varying vec2 pos;\n
+varying float Shape;\n
+varying vec4 DimBorderBlur;\n
+varying vec4 Corners;\n
+varying vec4 Fill;\n
+varying vec4 Outline;\n
+const float PI = 3.14159265359;\n
+\n
+float linearstep(float low, float high, float x) { return clamp((x - low) / (high - low), 0.0, 1.0); }\n
+vec2 rotate(vec2 p, float a) { return vec2(p.x*cos(a) + p.y*sin(a), p.x*sin(a) - p.y*cos(a)); }\n
+float linetopoint(vec2 p1, vec2 p2, vec2 p)\n
+{\n
+  vec2 n = p2 - p1;\n
+  n = vec2(n.y, -n.x);\n
+  return dot(normalize(n), p1 - p);\n
+}\n
+float rectangle(vec2 samplePosition, vec2 halfSize, vec4 edges) {\n
+    float edge = 20.0;\n
+    if(samplePosition.x > 0.0)\n
+      edge = (samplePosition.y < 0.0) ? edges.y : edges.z;\n
+    else\n
+      edge = (samplePosition.y < 0.0) ? edges.x : edges.w;\n
+    
+    vec2 componentWiseEdgeDistance = abs(samplePosition) - halfSize + vec2(edge);\n
+    float outsideDistance = length(max(componentWiseEdgeDistance, 0.0));\n
+    float insideDistance = min(max(componentWiseEdgeDistance.x, componentWiseEdgeDistance.y), 0.0);\n
+    return outsideDistance + insideDistance - edge;\n
+}\n
+
+// Each shape returns the coverage of its fill in x and the coverage of the whole shape in y. These are the SDFs from
+// RoundRect.fs, Circle.fs, Arc.fs and Triangle.fs, which must be kept in sync with this file.
+vec2 roundrect()\n
+{\n
+    float w = fwidth(DimBorderBlur.x*pos.x) * 0.5 * (1.0 + DimBorderBlur.w);\n
+    vec2 uv = (pos * DimBorderBlur.xy) - (DimBorderBlur.xy * 0.5);\n
+    
+    float dist = rectangle(uv, DimBorderBlur.xy * 0.5, Corners);\n
+    return vec2(linearstep(w, -w, dist + DimBorderBlur.z), linearstep(w, -w, dist));\n
+}\n
+
+vec2 circle()\n
+{\n
+    float l = (DimBorderBlur.x + DimBorderBlur.y) * 0.5;\n
+    vec2 uv = (pos*2.0) - 1.0;\n
+    float w1 = (1.0 + DimBorderBlur.w)*fwidth(pos.x); \n
+    
+    float border = (DimBorderBlur.z / l) * 2.0;\n
+    float t = 0.50 - (Corners.x / l);\n
+    float r = 1.0 - t - w1;\n
+    
+    float inner = (Corners.y / l) * 2.0;\n
+    float d0 = abs(length(uv) - r + (border*0.5) - (inner*0.5)) - t + (border*0.5) + (inner*0.5);\n
+    float d1 = abs(length(uv) - r) - t;\n
+    return vec2(pow(linearstep(w1*2.0, 0.0, d0), 2.2), pow(linearstep(w1*2.0, 0.0, d1), 2.2));\n
+}\n
+
+vec2 arc()\n
+{\n
+    float l = (DimBorderBlur.x + DimBorderBlur.y) * 0.5;\n
+    vec2 uv = (pos*2.0) - 1.0;\n
+    float width = fwidth(pos.x);\n
+    float w1 = (1.0 + DimBorderBlur.w)*width;\n 
+    
+    float border = (DimBorderBlur.z / l) * 2.0;\n
+    float t = 0.50 - (Corners.z / l) + w1*1.5;\n
+    float r = 1.0 - t + w1;\n
+    
+    float d0 = abs(length(uv) - r) - t + border;\n
+    float d1 = abs(length(uv) - r) - t;\n
+
+    vec2 omega1 = rotate(uv, Corners.x - Corners.y);\n
+    vec2 omega2 = rotate(uv, Corners.x + Corners.y);\n
+    float d;\n
+    
+    if(abs(-omega1.y) + abs(omega2.y) < width) {\n
+      d = ((Corners.y/PI) - 0.5)*2.0*width;\n
+    } else if(Corners.y > PI*0.5) {\n
+      d = max(-omega1.y, omega2.y);\n
+    } else {\n
+      d = min(-omega1.y, omega2.y);\n
+    }\n
+    
+    d += (clamp(Corners.y/PI, 0.0, 1.0) - 0.5)*2.0*(DimBorderBlur.w * width) + border;\n
+    
+    float d2 = d - border + w1;\n
+    float d3 = min(d, omega1.x + Corners.y) + w1;\n
+    return vec2(linearstep(-w1, w1, min(-d0, d2) - w1), linearstep(-w1, w1, min(-d1, d3) - w1));\n
+}\n
+
+vec2 triangle()\n
+{\n
+  vec2 d = DimBorderBlur.xy;\n
+  vec2 p = pos * d + vec2(-0.5,0.5);\n
+  vec4 c = Corners;\n
+  vec2 p2 = vec2(c.w*d.x, 0.0);\n
+  float r1 = linetopoint(p2, vec2(0.0, d.y), p);\n
+  float r2 = -linetopoint(p2, d, p);\n
+  float r = max(r1, r2);\n
+  r = max(r, p.y - d.y);\n
+  \n
+  float w = fwidth(p.x) * (1.0 + DimBorderBlur.w);\n
+  return vec2(1.0 - linearstep(1.0 - DimBorderBlur.z - w*2.0, 1.0 - DimBorderBlur.z - w, r), linearstep(1.0 - w, 1.0 - w*2.0, r));\n
+}\n
+
+void main()\n
+{\n
+  // Shape is constant across an instance, so every branch here is uniform for the derivatives each SDF takes
+  vec2 s;\n
+  if(Shape < 0.5)\n
+    s = roundrect();\n
+  else if(Shape < 1.5)\n
+    s = circle();\n
+  else if(Shape < 2.5)\n
+    s = arc();\n
+  else\n
+    s = triangle();\n
+  gl_FragColor = (vec4(Fill.rgb, 1.0)*Fill.a*s.x) + (vec4(Outline.rgb, 1.0)*Outline.a*clamp(s.y - s.x, 0.0, 1.0));\n
+}\n
+)
\ No newline at end of file
@@ -7,10 +7,44 @@
 
 using namespace GL;
 
+namespace {
+  GLenum GetAttribType(const FG_ShaderParameter& param)
+  {
+    switch(param.type)
+    {
+    case FG_ShaderType_INT: return GL_INT;
+    case FG_ShaderType_UINT: return GL_UNSIGNED_INT;
+    }
+    return GL_FLOAT;
+  }
+
+  // Calls f(location, elements, type, offset) for every attribute slot. Matrix attributes take up one slot per column.
+  template<class F>
+  void ForEachAttrib(Backend* backend, GLuint shader, const FG_ShaderParameter* parameters, size_t n_parameters, F&& f)
+  {
+    size_t offset = 0;
+    for(size_t i = 0; i < n_parameters; ++i)
+    {
+      auto loc = glGetAttribLocation(shader, parameters[i].name);
+      backend->LogError("glGetAttribLocation");
+      GLenum type = GetAttribType(parameters[i]);
+      int columns = !parameters[i].multi ? 1 : parameters[i].multi;
+
+      for(int c = 0; c < columns; ++c)
+      {
+        if(loc >= 0)
+          f(static_cast<GLuint>(loc + c), static_cast<GLint>(parameters[i].length), type, offset);
+        offset += Context::GetBytes(type) * parameters[i].length;
+      }
+    }
+  }
+}
+
 #ifndef USE_EMULATED_VAOS
 
 VAO::VAO(Backend* backend, GLuint shader, const FG_ShaderParameter* parameters, size_t n_parameters, GLuint buffer,
-         size_t stride, GLuint indices) :
+         size_t stride, GLuint indices, const FG_ShaderParameter* instanced, size_t n_instanced, GLuint instancebuffer,
+         size_t instancestride) :
   _backend(backend)
 {
   glGenVertexArrays(1, &_vaoID);
@@ -26,25 +60,26 @@ VAO::VAO(Backend* backend, GLuint shader, const FG_ShaderParameter* parameters,
     _backend->LogError("glBindBuffer");
   }
 
-  GLuint offset = 0;
-  for(size_t i = 0; i < n_parameters; ++i)
-  {
-    auto loc = glGetAttribLocation(shader, parameters[i].name);
-    _backend->LogError("glGetAttribLocation");
+  ForEachAttrib(_backend, shader, parameters, n_parameters, [&](GLuint loc, GLint sz, GLenum type, size_t offset) {
     glEnableVertexAttribArray(loc);
     _backend->LogError("glEnableVertexAttribArray");
-    size_t sz   = Context::GetMultiCount(parameters[i].length, parameters[i].multi);
-    GLenum type = 0;
-    switch(parameters->type)
-    {
-    case FG_ShaderType_FLOAT: type = GL_FLOAT; break;
-    case FG_ShaderType_INT: type = GL_INT; break;
-    case FG_ShaderType_UINT: type = GL_UNSIGNED_INT; break;
-    }
-
-    glVertexAttribPointer(loc, sz, type, GL_FALSE, stride, (void*)offset);
-    offset += Context::GetBytes(type) * sz;
+    glVertexAttribPointer(loc, sz, type, GL_FALSE, static_cast<GLsizei>(stride), (void*)offset);
     _backend->LogError("glVertexAttribPointer");
+  });
+
+  if(n_instanced > 0)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, instancebuffer);
+    _backend->LogError("glBindBuffer");
+
+    ForEachAttrib(_backend, shader, instanced, n_instanced, [&](GLuint loc, GLint sz, GLenum type, size_t offset) {
+      glEnableVertexAttribArray(loc);
+      _backend->LogError("glEnableVertexAttribArray");
+      glVertexAttribPointer(loc, sz, type, GL_FALSE, static_cast<GLsizei>(instancestride), (void*)offset);
+      _backend->LogError("glVertexAttribPointer");
+      glVertexAttribDivisor(loc, 1);
+      _backend->LogError("glVertexAttribDivisor");
+    });
   }
 
   glBindVertexArray(0);
@@ -76,56 +111,52 @@ void VAO::Unbind()
 #else
 
 VAO::VAO(Backend* backend, GLuint shader, const FG_ShaderParameter* parameters, size_t n_parameters, GLuint buffer,
-         size_t stride, GLuint indices) :
-  _n_attribs(n_parameters), _vertexBuffer(buffer), _stride(stride), _indexBuffer(indices), _backend(backend)
+         size_t stride, GLuint indices, const FG_ShaderParameter* instanced, size_t n_instanced, GLuint instancebuffer,
+         size_t instancestride) :
+  _indexBuffer(indices), _backend(backend)
 {
-  _attribs = new VAO::VertexAttrib[n_parameters];
-
-  for(size_t i = 0; i < n_parameters; ++i)
-  {
-    _attribs[i].location = glGetAttribLocation(shader, parameters[i].name);
-    _backend->LogError("glGetAttribLocation");
-
-    _attribs[i].numElements = Context::GetMultiCount(parameters[i].length, parameters[i].multi);
-    switch(parameters->type)
-    {
-    case FG_ShaderType_FLOAT: _attribs[i].type = GL_FLOAT; break;
-    case FG_ShaderType_INT: _attribs[i].type = GL_INT; break;
-    case FG_ShaderType_UINT: _attribs[i].type = GL_UNSIGNED_INT; break;
-    }
-  }
+  ForEachAttrib(_backend, shader, parameters, n_parameters, [&](GLuint loc, GLint sz, GLenum type, size_t offset) {
+    _attribs.push_back({ loc, sz, type, buffer, static_cast<GLsizei>(stride), offset, 0 });
+  });
+  ForEachAttrib(_backend, shader, instanced, n_instanced, [&](GLuint loc, GLint sz, GLenum type, size_t offset) {
+    _attribs.push_back({ loc, sz, type, instancebuffer, static_cast<GLsizei>(instancestride), offset, 1 });
+  });
 }
 
-VAO::~VAO() { delete[] _attribs; }
+VAO::~VAO() {}
 
 void VAO::Bind()
 {
-  glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
-  _backend->LogError("glBindBuffer");
   if(_indexBuffer != 0)
   {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
     _backend->LogError("glBindBuffer");
   }
 
-  GLuint offset = 0;
-  for(size_t i = 0; i < _n_attribs; ++i)
+  for(auto& a : _attribs)
   {
-    glEnableVertexAttribArray(_attribs[i].location);
+    glBindBuffer(GL_ARRAY_BUFFER, a.buffer);
+    _backend->LogError("glBindBuffer");
+    glEnableVertexAttribArray(a.location);
     _backend->LogError("glEnableVertexAttribArray");
 
-    glVertexAttribPointer(_attribs[i].location, _attribs[i].numElements, _attribs[i].type, GL_FALSE, _stride,
-                          (void*)offset);
+    glVertexAttribPointer(a.location, a.numElements, a.type, GL_FALSE, a.stride, (void*)a.offset);
     _backend->LogError("glVertexAttribPointer");
-    offset += Context::GetBytes(_attribs[i].type) * _attribs[i].numElements;
+    if(a.divisor)
+    {
+      glVertexAttribDivisor(a.location, a.divisor);
+      _backend->LogError("glVertexAttribDivisor");
+    }
   }
 }
 
 void VAO::Unbind()
 {
-  for(size_t i = 0; i < _n_attribs; ++i)
+  for(auto& a : _attribs)
   {
-    glDisableVertexAttribArray(_attribs[i].location);
+    if(a.divisor)
+      glVertexAttribDivisor(a.location, 0);
+    glDisableVertexAttribArray(a.location);
     _backend->LogError("glDisableVertexAttribArray");
   }
 
@@ -137,4 +168,4 @@ void VAO::Unbind()
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   _backend->LogError("glBindBuffer");
 }
-#endif
\ No newline at end of file
+#endif
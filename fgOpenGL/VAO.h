@@ -30,17 +30,21 @@ namespace GL {
 
       /// OpenGL datatype of attribute elements. GL_FLOAT, GL_INT, GL_UNSIGNED_INT, etc.
       GLenum type;
-    };
 
-    size_t _n_attribs;
+      /// OpenGL object ID of the buffer this attribute is sourced from
+      GLuint buffer;
+
+      /// Total size in bytes of all vertex attributes in the source buffer
+      GLsizei stride;
 
-    VertexAttrib* _attribs;
+      /// Byte offset of this attribute inside each element of the source buffer
+      size_t offset;
 
-    /// Total size in bytes of all vertex attributes
-    size_t _stride;
+      /// 0 for per-vertex attributes, 1 for per-instance attributes
+      GLuint divisor;
+    };
 
-    /// OpenGL object ID of underlying vertex buffer for the VAO
-    GLuint _vertexBuffer;
+    std::vector<VertexAttrib> _attribs;
 
     /// OpenGL object ID of underlying index buffer for the VAO
     GLuint _indexBuffer;
@@ -49,8 +53,10 @@ namespace GL {
     Backend* _backend;
 
   public:
+    // If instanced parameters are given, they are sourced from instancebuffer and advance once per instance.
     VAO(Backend* backend, GLuint shader, const FG_ShaderParameter* parameters, size_t n_parameters, GLuint buffer,
-        size_t stride, GLuint indices);
+        size_t stride, GLuint indices, const FG_ShaderParameter* instanced = nullptr, size_t n_instanced = 0,
+        GLuint instancebuffer = 0, size_t instancestride = 0);
     ~VAO();
 
     void Bind();
@@ -10,6 +10,21 @@
 
 using namespace GL;
 
+namespace {
+  inline bool RectOverlaps(const FG_Rect& a, const FG_Rect& b)
+  {
+    return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+  }
+
+  inline void RectUnion(FG_Rect& a, const FG_Rect& b)
+  {
+    a.left   = std::min(a.left, b.left);
+    a.top    = std::min(a.top, b.top);
+    a.right  = std::max(a.right, b.right);
+    a.bottom = std::max(a.bottom, b.bottom);
+  }
+}
+
 // We have to translate all of GLFW's key values into Feather's universal key codes.
 uint8_t Window::KeyMap[512] = { 1, 0 };
 void Window::FillKeyMap()
@@ -142,7 +157,8 @@ void Window::FillKeyMap()
 
 Window::Window(Backend* backend, GLFWmonitor* display, FG_MsgReceiver* element, FG_Vec* pos, FG_Vec* dim, uint64_t flags,
                const char* caption) :
-  Context(backend, element, dim), _next(nullptr), _prev(nullptr)
+  Context(backend, element, dim), _next(nullptr), _prev(nullptr), _history(), _bufferage(false), _nextframe(0.0),
+  _vsync(false)
 {
   FillKeyMap();
   if(flags & FG_WindowFlag_NOCAPTION)
@@ -191,6 +207,8 @@ Window::Window(Backend* backend, GLFWmonitor* display, FG_MsgReceiver* element,
       (*_backend->_log)(_backend->_root, FG_Level_ERROR, "gladLoadGL failed");
     _backend->LogError("gladLoadGL");
     CreateResources();
+    _bufferage = HasBufferAge(_window);
+    glfwSwapInterval(0); // DrawFrames turns vsync on for one window at a time
   }
   else
     (*_backend->_log)(_backend->_root, FG_Level_ERROR, "glfwCreateWindow failed");
@@ -217,22 +235,109 @@ Window::~Window()
   }
 }
 
+double Window::GetFrameInterval() const
+{
+  // Windowed mode windows don't have a monitor, so we assume they're on the primary one
+  GLFWmonitor* monitor    = glfwGetWindowMonitor(_window);
+  const GLFWvidmode* mode = glfwGetVideoMode(!monitor ? glfwGetPrimaryMonitor() : monitor);
+  double interval         = (mode && mode->refreshRate > 0) ? 1.0 / mode->refreshRate : 0.0;
+  return std::max(interval, _backend->_frametime);
+}
+
+// This only marks the area as needing a redraw. The frame itself is drawn by ProcessMessages when the window is due.
 void Window::DirtyRect(const FG_Rect* area)
 {
-#ifdef FG_PLATFORM_WIN32
-  auto hWnd = glfwGetWin32Window(_window);
+  if(area)
+    AddDamage(*area);
+  else
+  {
+    int w;
+    int h;
+    glfwGetFramebufferSize(_window, &w, &h);
+    AddDamage(FG_Rect{ 0, 0, static_cast<float>(w), static_cast<float>(h) });
+  }
+}
+
+void Window::AddDamage(const FG_Rect& rect)
+{
+  if(rect.right <= rect.left || rect.bottom <= rect.top)
+    return;
+
+  // Keep absorbing rects until the merged rect doesn't touch anything, since growing it can create new overlaps
+  FG_Rect merged = rect;
+  for(size_t i = 0; i < _damage.size();)
+  {
+    if(RectOverlaps(merged, _damage[i]))
+    {
+      RectUnion(merged, _damage[i]);
+      _damage.erase(_damage.begin() + i);
+      i = 0;
+    }
+    else
+      ++i;
+  }
+  _damage.push_back(merged);
+
+  if(_damage.size() > MAX_DAMAGE)
+  {
+    for(size_t i = 1; i < _damage.size(); ++i)
+      RectUnion(_damage[0], _damage[i]);
+    _damage.resize(1);
+  }
+}
+
+void Window::DrawDamage(double now, bool vsync)
+{
+  if(_damage.empty() || !_window || now < _nextframe)
+    return;
+
+  // Schedule from the previous deadline so we don't drift, unless we fell more than a frame behind
+  _nextframe = std::max(_nextframe + GetFrameInterval(), now);
 
-  if(!area)
-    InvalidateRect(hWnd, NULL, FALSE);
+  FG_Rect bounds = _damage[0];
+  for(auto& r : _damage)
+    RectUnion(bounds, r);
+
+  _backend->BeginDraw(_backend, this, nullptr);
+
+  // Changing the swap interval can be expensive on some drivers, so only do it when it changes
+  if(_vsync != vsync)
+  {
+    glfwSwapInterval(vsync ? 1 : 0);
+    _vsync = vsync;
+  }
+
+  // The back buffer still holds whatever frame was drawn into it last, so everything that changed since then has to be
+  // redrawn too. If we don't know how old it is, its contents are undefined and we have to redraw all of it.
+  unsigned int age = !_bufferage ? 0 : GetBufferAge(_window);
+  if(age == 0 || age > MAX_BUFFER_AGE)
+  {
+    int w;
+    int h;
+    glfwGetFramebufferSize(_window, &w, &h);
+    _damage.clear();
+    _damage.push_back(FG_Rect{ 0, 0, static_cast<float>(w), static_cast<float>(h) });
+  }
   else
   {
-    RECT rect = { static_cast<LONG>(floorf(area->left)), static_cast<LONG>(floorf(area->top)),
-                  static_cast<LONG>(ceilf(area->right)), static_cast<LONG>(ceilf(area->bottom)) };
-    InvalidateRect(hWnd, &rect, FALSE);
+    for(unsigned int i = 0; i + 1 < age; ++i)
+      AddDamage(_history[i]);
   }
-#else
-  Draw(area);
-#endif
+
+  memmove(_history + 1, _history, sizeof(FG_Rect) * (MAX_BUFFER_AGE - 1));
+  _history[0] = bounds;
+
+  FG_Msg msg = { FG_Kind_DRAW };
+  for(auto& r : _damage)
+  {
+    msg.draw.area = r;
+    PushClip(r);
+    _backend->Behavior(this, msg);
+    PopClip();
+  }
+  _damage.clear();
+
+  _backend->EndDraw(_backend, this);
 }
 
 uint8_t Window::GetModKeys(int mods)
@@ -375,5 +480,10 @@ void Window::SizeCallback(GLFWwindow* window, int width, int height)
 
 void Window::RefreshCallback(GLFWwindow* window)
 {
+#ifdef FG_PLATFORM_WIN32
   reinterpret_cast<Window*>(glfwGetWindowUserPointer(window))->Draw(nullptr);
+#else
+  // Drawn by ProcessMessages once all pending events are handled
+  reinterpret_cast<Window*>(glfwGetWindowUserPointer(window))->DirtyRect(nullptr);
+#endif
 }
@@ -11,6 +11,11 @@ namespace GL {
   class Backend;
   struct Asset;
 
+  // Platform specific queries for GLX_EXT_buffer_age, kept in BufferAge.cpp so the X11 headers don't leak into our code
+  bool HasBufferAge(GLFWwindow* window);
+  // Returns how many frames ago the back buffer was drawn, or 0 if its contents are undefined
+  unsigned int GetBufferAge(GLFWwindow* window);
+
   struct Window : Context
   {
     Window(Backend* backend, GLFWmonitor* display, FG_MsgReceiver* element, FG_Vec* pos, FG_Vec* dim, uint64_t flags,
@@ -20,6 +25,13 @@ namespace GL {
     size_t SetChar(int key, unsigned long time);
     size_t SetMouse(FG_Vec& points, FG_Kind type, unsigned char button, size_t wparam, unsigned long time);
     virtual void DirtyRect(const FG_Rect* rect) override;
+    // Adds a rect to the damage region, merging it with any rects it overlaps
+    void AddDamage(const FG_Rect& rect);
+    // Redraws the damage region if there is any and the window is due for a new frame. Called by ProcessMessages.
+    // If vsync is true, the swap waits for vertical blank.
+    void DrawDamage(double now, bool vsync);
+    // Shortest time between two frames, which is the display's refresh interval or the backend's frame cap
+    double GetFrameInterval() const;
     static uint8_t GetModKeys(int mods);
     static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void CloseCallback(GLFWwindow* window);
@@ -33,9 +45,17 @@ namespace GL {
     static void SizeCallback(GLFWwindow* window, int width, int height);
     static void RefreshCallback(GLFWwindow* window);
 
+    static const size_t MAX_DAMAGE  = 8; // Past this many rects we just redraw their bounds
+    static const int MAX_BUFFER_AGE = 4;
+
     uint64_t _flags;
     Window* _next; // GLFW doesn't let us detect when it destroys a window so we have to do it ourselves.
     Window* _prev;
+    std::vector<FG_Rect> _damage;     // Rects that have to be redrawn on the next frame, none of which overlap
+    FG_Rect _history[MAX_BUFFER_AGE]; // Bounds of the damage drawn in each of the last few frames, newest first
+    bool _bufferage;                  // True if we can ask how old the back buffer is (GLX_EXT_buffer_age)
+    double _nextframe;                // glfwGetTime() at which this window can draw its next frame
+    bool _vsync;                      // Swap interval currently set on this window's context
 
     static uint8_t KeyMap[512];
     static void FillKeyMap();
@@ -45,6 +45,18 @@
   #define FG_PLATFORM_POSIX
 #endif
 
+// Instruction sets the compiler is allowed to emit. Nothing is detected at runtime, so AVX2 is only used when the build
+// targets it (-mavx2 or /arch:AVX2).
+#if defined(__AVX2__)
+  #define FG_AVX2_ENABLED
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define FG_SSE2_ENABLED
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+  #define FG_NEON_ENABLED
+#endif
+
 #ifdef FG_PLATFORM_WIN32
   #define ALLOCA(x)                 _alloca(x)
   #define MEMCPY(d, size, s, len)   memcpy_s(d, size, s, len)
@@ -0,0 +1,30 @@
+TXT(#version 110\n
+attribute vec2 vPos;\n
+attribute mat4 vMVP;\n
+attribute vec4 vDimBorderBlur;\n
+attribute vec4 vCorners;\n
+attribute vec4 vFill;\n
+attribute vec4 vOutline;\n
+attribute vec2 vInflate;\n
+attribute float vShape;\n
+varying vec2 pos;\n
+varying vec4 DimBorderBlur;\n
+varying vec4 Corners;\n
+varying vec4 Fill;\n
+varying vec4 Outline;\n
+varying float Shape;\n
+
+void main()\n
+{\n
+  DimBorderBlur = vDimBorderBlur;\n
+  Corners = vCorners;\n
+  Fill = vFill;\n
+  Outline = vOutline;\n
+  Shape = vShape;\n
+  pos = vPos.xy;\n
+  pos -= vec2(0.5,0.5);\n
+  pos *= vInflate;\n
+  pos += vec2(0.5,0.5);\n
+  gl_Position = vMVP * vec4(pos, 0, 1);\n
+}\n
+)
\ No newline at end of file
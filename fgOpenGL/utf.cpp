@@ -1,4 +1,14 @@
 #include "utf.h"
+#include <string.h>
+
+#if defined(FG_AVX2_ENABLED) || defined(FG_SSE2_ENABLED)
+  #include <immintrin.h>
+#elif defined(FG_NEON_ENABLED)
+  #include <arm_neon.h>
+#endif
+#ifdef FG_COMPILER_MSC
+  #include <intrin.h>
+#endif
 
 /*
  * Copyright 2001-2004 Unicode, Inc.
@@ -145,28 +155,161 @@ char isLegalUTF8(const UTF8* source, int length)
   return true;
 }
 
-size_t UTF8toUTF32(const char* FG_RESTRICT input, ptrdiff_t srclen, char32_t* FG_RESTRICT output,
-                                 size_t buflen)
+// Everything above this line is the reference decoder from Unicode, Inc. It's still used for every multi-byte sequence,
+// while runs of ASCII, which is what most text is made of, are widened a whole vector at a time.
+
+#if defined(FG_AVX2_ENABLED)
+  #define UTF_BLOCK 32
+#elif defined(FG_SSE2_ENABLED) || defined(FG_NEON_ENABLED)
+  #define UTF_BLOCK 16
+#endif
+
+#ifdef UTF_BLOCK
+static FG_FORCEINLINE int countTrailingZeros(uint64_t x)
+{
+  #ifdef FG_COMPILER_MSC
+  unsigned long i;
+    #ifdef _WIN64
+  _BitScanForward64(&i, x);
+    #else
+  if(!_BitScanForward(&i, static_cast<unsigned long>(x)))
+  {
+    _BitScanForward(&i, static_cast<unsigned long>(x >> 32));
+    i += 32;
+  }
+    #endif
+  return static_cast<int>(i);
+  #else
+  return __builtin_ctzll(x);
+  #endif
+}
+
+/*
+ * Widens the next UTF_BLOCK bytes into UTF_BLOCK code points, whether they're
+ * ASCII or not, and returns how many of them were ASCII before the first byte
+ * that wasn't. Only that many code points are valid, everything after them
+ * is overwritten by the caller.
+ */
+static FG_FORCEINLINE size_t widenASCII(const UTF8* source, UTF32* target)
+{
+  #if defined(FG_AVX2_ENABLED)
+  const int bits = 1; // Mask bits per byte
+  __m256i v      = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+  uint64_t mask  = static_cast<uint32_t>(_mm256_movemask_epi8(v));
+  for(int i = 0; i < 4; ++i)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + i * 8),
+                        _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + i * 8))));
+  #elif defined(FG_SSE2_ENABLED)
+  const int bits      = 1;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v          = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+  uint64_t mask      = static_cast<uint32_t>(_mm_movemask_epi8(v));
+  __m128i lo         = _mm_unpacklo_epi8(v, zero);
+  __m128i hi         = _mm_unpackhi_epi8(v, zero);
+  __m128i* out       = reinterpret_cast<__m128i*>(target);
+  _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo, zero));
+  _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+  _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+  _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+  #else
+  // NEON has no movemask, but narrowing each 16-bit lane by 4 bits leaves one nibble per byte
+  const int bits  = 4;
+  uint8x16_t v    = vld1q_u8(source);
+  uint8x16_t high = vcgeq_u8(v, vdupq_n_u8(0x80));
+  uint64_t mask   = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(high), 4)), 0);
+  uint16x8_t lo   = vmovl_u8(vget_low_u8(v));
+  uint16x8_t hi   = vmovl_u8(vget_high_u8(v));
+  vst1q_u32(target + 0, vmovl_u16(vget_low_u16(lo)));
+  vst1q_u32(target + 4, vmovl_u16(vget_high_u16(lo)));
+  vst1q_u32(target + 8, vmovl_u16(vget_low_u16(hi)));
+  vst1q_u32(target + 12, vmovl_u16(vget_high_u16(hi)));
+  #endif
+  return !mask ? UTF_BLOCK : countTrailingZeros(mask) / bits;
+}
+#endif
+
+/*
+ * Counts every byte that starts a code point, which is everything except
+ * 10xxxxxx continuation bytes. As signed bytes, continuations are exactly
+ * the values below -64. Each lane of the accumulator counts up to 255
+ * blocks before it's summed.
+ */
+static size_t countCodepoints(const UTF8* source, const UTF8* sourceEnd)
+{
+  size_t count = 0;
+#if defined(FG_AVX2_ENABLED)
+  const __m256i limit = _mm256_set1_epi8(-65);
+  while(sourceEnd - source >= 32)
+  {
+    __m256i acc   = _mm256_setzero_si256();
+    size_t blocks = (sourceEnd - source) / 32;
+    for(size_t i = 0; i < blocks && i < 255; ++i, source += 32)
+      acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)), limit));
+    __m256i sad = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sad), _mm256_extracti128_si256(sad, 1));
+    count += _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+  }
+#elif defined(FG_SSE2_ENABLED)
+  const __m128i limit = _mm_set1_epi8(-65);
+  while(sourceEnd - source >= 16)
+  {
+    __m128i acc   = _mm_setzero_si128();
+    size_t blocks = (sourceEnd - source) / 16;
+    for(size_t i = 0; i < blocks && i < 255; ++i, source += 16)
+      acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)), limit));
+    __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+    count += _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+  }
+#elif defined(FG_NEON_ENABLED)
+  const int8x16_t limit = vdupq_n_s8(-65);
+  while(sourceEnd - source >= 16)
+  {
+    uint8x16_t acc = vdupq_n_u8(0);
+    size_t blocks  = (sourceEnd - source) / 16;
+    for(size_t i = 0; i < blocks && i < 255; ++i, source += 16)
+      acc = vsubq_u8(acc, vcgtq_s8(vreinterpretq_s8_u8(vld1q_u8(source)), limit));
+    uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+    count += vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+  }
+#endif
+  for(; source < sourceEnd; ++source)
+    count += ((*source) & 0b11000000) != 0b10000000;
+  return count;
+}
+
+/*
+ * A negative srclen means the input is null-terminated. Either way, decoding
+ * stops after the first null, which is decoded too. Without an output
+ * buffer, this returns how many code points the input holds plus one for a
+ * terminator, so callers can size their buffer exactly.
+ */
+size_t UTF8toUTF32(const char* FG_RESTRICT input, ptrdiff_t srclen, char32_t* FG_RESTRICT output, size_t buflen)
 {
   if(!srclen)
     return 0;
-  const UTF8* source = (UTF8*)input;
+  const UTF8* source = (const UTF8*)input;
   UTF32* target      = (UTF32*)output;
   UTF32* targetEnd   = target + buflen;
-  if(srclen < 0)
-    srclen = PTRDIFF_MAX;
-  buflen = 1;
-  while(*input && (input - (const char*)source) < srclen)
-  {
-    buflen += (((*input) & 0b11000000) != 0b10000000);
-    ++input;
-  }
+
+  // strlen and memchr are already vectorized by the C library
+  const UTF8* terminator =
+    (srclen < 0) ? source + strlen(input) : (const UTF8*)memchr(input, 0, static_cast<size_t>(srclen));
   if(!output)
-    return buflen;
-  const UTF8* sourceEnd = ((input - (const char*)source) < srclen) ? (UTF8*)(++input) : (source + srclen);
+    return countCodepoints(source, !terminator ? source + srclen : terminator) + 1;
+  const UTF8* sourceEnd = !terminator ? source + srclen : terminator + 1;
 
   while(source < sourceEnd)
   {
+#ifdef UTF_BLOCK
+    if(*source < 0x80 && sourceEnd - source >= UTF_BLOCK && targetEnd - target >= UTF_BLOCK)
+    {
+      size_t n = widenASCII(source, target);
+      source += n;
+      target += n;
+      if(n == UTF_BLOCK)
+        continue;
+    }
+#endif
     UTF32 ch                        = 0;
     unsigned short extraBytesToRead = trailingBytesForUTF8[*source];
     if(extraBytesToRead >= sourceEnd - source)
@@ -374,44 +374,28 @@ struct FG_BlendState__ {
   FG_Color constant;
 };
 typedef int32_t (* FG_anon_7)(FG_Backend *, FG_Window *, FG_Command *, uint32_t, FG_BlendState *);
-typedef FG_Asset * (* FG_anon_20)(FG_Backend *, const char*, uint32_t, FG_Format, int32_t);
-enum FG_Clipboard {
-  FG_Clipboard_NONE = 0,
-  FG_Clipboard_ALL = 7,
-  FG_Clipboard_CUSTOM = 6,
-  FG_Clipboard_WAVE = 2,
-  FG_Clipboard_BITMAP = 3,
-  FG_Clipboard_ELEMENT = 5,
-  FG_Clipboard_FILE = 4,
-  FG_Clipboard_TEXT = 1
-};
-typedef int32_t (* FG_anon_21)(FG_Backend *, FG_Window *, FG_Clipboard);
-typedef struct FG_Display__ FG_Display;
-struct FG_Display__ {
-  FG_Veci size;
-  FG_Veci offset;
-  FG_Vec dpi;
-  float scale;
-  void * handle;
-  bool primary;
-};
-typedef int32_t (* FG_anon_22)(FG_Backend *, uint32_t, FG_Display *);
-typedef int32_t (* FG_anon_23)(FG_Backend *, FG_Window *, FG_Rect *);
-typedef int32_t (* FG_anon_24)(FG_Backend *);
-typedef struct FG_MsgReceiver__ FG_MsgReceiver;
-struct FG_MsgReceiver__ {
-  void * * vftable;
+typedef bool (* FG_anon_20)(FG_Backend *, FG_Window *, FG_Color);
+typedef int32_t (* FG_anon_21)(FG_Backend *, FG_Window *, FG_Asset *, float *, float, FG_BlendState *);
+typedef int32_t (* FG_anon_22)(FG_Backend *, FG_Window *);
+typedef int32_t (* FG_anon_23)(FG_Backend *, FG_Window *, FG_Asset *, FG_Rect *);
+typedef int32_t (* FG_anon_24)(FG_Backend *, FG_Window *, FG_Asset *);
+typedef int32_t (* FG_anon_25)(FG_Backend *, FG_Window *, FG_Rect *);
+typedef FG_Shader * (* FG_anon_26)(FG_Backend *, const char*, const char*, const char*, const char*, const char*, const char*, FG_ShaderParameter *, uint32_t);
+typedef int32_t (* FG_anon_27)(FG_Backend *, FG_Shader *);
+typedef FG_Font * (* FG_anon_28)(FG_Backend *, const char*, uint16_t, bool, uint32_t, FG_Vec, FG_AntiAliasing);
+typedef int32_t (* FG_anon_29)(FG_Backend *, FG_Font *);
+enum FG_BreakStyle {
+  FG_BreakStyle_NONE = 0,
+  FG_BreakStyle_CHARACTER = 2,
+  FG_BreakStyle_WORD = 1
 };
-typedef FG_Window * (* FG_anon_25)(FG_Backend *, FG_MsgReceiver *, void *, FG_Vec *, FG_Vec *, const char*, uint64_t);
-typedef FG_Window * (* FG_anon_26)(FG_Backend *, FG_MsgReceiver *, FG_Window, FG_Vec3, FG_Vec3);
-typedef int32_t (* FG_anon_27)(FG_Backend *, FG_Window *, FG_Clipboard, const char*, uint32_t);
-typedef FG_Vec (* FG_anon_28)(FG_Backend *, FG_Font *, void *, FG_Rect *, uint32_t);
-typedef int32_t (* FG_anon_29)(FG_Backend *, FG_Window *);
-typedef int32_t (* FG_anon_30)(FG_Backend *, FG_Window *, void *, FG_Rect *, ...);
-typedef bool (* FG_anon_31)(FG_Backend *, FG_Window *, FG_Color);
-typedef int32_t (* FG_anon_32)(FG_Backend *, FG_Window *, FG_Asset *);
-typedef void * (* FG_anon_33)(FG_Backend *);
-typedef int32_t (* FG_anon_34)(FG_Backend *, FG_Window *, FG_Display *);
+typedef void * (* FG_anon_30)(FG_Backend *, FG_Font *, const char*, FG_Rect *, float, float, FG_BreakStyle, void *);
+typedef int32_t (* FG_anon_31)(FG_Backend *, void *);
+typedef uint32_t (* FG_anon_32)(FG_Backend *, FG_Font *, void *, FG_Rect *, FG_Vec, FG_Vec *);
+typedef FG_Vec (* FG_anon_33)(FG_Backend *, FG_Font *, void *, FG_Rect *, uint32_t);
+typedef int32_t (* FG_anon_34)(FG_Backend *, FG_Font *, const char*, uint32_t, uint32_t);
+typedef int32_t (* FG_anon_35)(FG_Backend *, FG_Font *, FG_Font **, uint32_t);
+typedef FG_Asset * (* FG_anon_36)(FG_Backend *, const char*, uint32_t, FG_Format, int32_t);
 enum FG_Primitive {
   FG_Primitive_LINE = 1,
   FG_Primitive_INDEX_INT = 11,
@@ -426,16 +410,30 @@ enum FG_Primitive {
   FG_Primitive_LINE_ADJACENCY = 5,
   FG_Primitive_TRIANGLE_STRIP = 4
 };
-typedef FG_Asset * (* FG_anon_35)(FG_Backend *, void *, uint32_t, uint8_t, FG_ShaderParameter *, uint32_t);
-typedef int32_t (* FG_anon_36)(FG_Backend *, FG_Asset *);
-typedef bool (* FG_anon_37)(FG_Backend *, FG_Window *, FG_Clipboard);
+typedef FG_Asset * (* FG_anon_37)(FG_Backend *, void *, uint32_t, uint8_t, FG_ShaderParameter *, uint32_t);
 typedef FG_Asset * (* FG_anon_38)(FG_Backend *, FG_Window *, FG_Vec *, int32_t);
-typedef int32_t (* FG_anon_39)(FG_Backend *, void *, FG_Display *);
-typedef int32_t (* FG_anon_40)(FG_Backend *, FG_Window *, FG_MsgReceiver *, void *, FG_Vec *, FG_Vec *, const char*, uint64_t);
-typedef int32_t (* FG_anon_41)(FG_Backend *, void *);
-typedef int32_t (* FG_anon_42)(FG_Backend *, FG_Shader *);
-typedef int32_t (* FG_anon_43)(FG_Backend *, FG_Font *);
-typedef FG_Font * (* FG_anon_44)(FG_Backend *, const char*, uint16_t, bool, uint32_t, FG_Vec, FG_AntiAliasing);
+typedef int32_t (* FG_anon_39)(FG_Backend *, FG_Asset *);
+typedef int32_t (* FG_anon_40)(FG_Backend *, FG_Window *, FG_Asset *, float *);
+enum FG_Clipboard {
+  FG_Clipboard_NONE = 0,
+  FG_Clipboard_ALL = 7,
+  FG_Clipboard_CUSTOM = 6,
+  FG_Clipboard_WAVE = 2,
+  FG_Clipboard_BITMAP = 3,
+  FG_Clipboard_ELEMENT = 5,
+  FG_Clipboard_FILE = 4,
+  FG_Clipboard_TEXT = 1
+};
+typedef int32_t (* FG_anon_41)(FG_Backend *, FG_Window *, FG_Clipboard, const char*, uint32_t);
+typedef uint32_t (* FG_anon_42)(FG_Backend *, FG_Window *, FG_Clipboard, void *, uint32_t);
+typedef bool (* FG_anon_43)(FG_Backend *, FG_Window *, FG_Clipboard);
+typedef int32_t (* FG_anon_44)(FG_Backend *, FG_Window *, FG_Clipboard);
+typedef void * (* FG_anon_45)(FG_Backend *, FG_Window *, const char*, FG_Rect *, ...);
+typedef int32_t (* FG_anon_46)(FG_Backend *, FG_Window *, void *, FG_Rect *, ...);
+typedef int32_t (* FG_anon_47)(FG_Backend *, FG_Window *, void *);
+typedef void * (* FG_anon_48)(FG_Backend *);
+typedef int32_t (* FG_anon_49)(FG_Backend *);
+typedef int32_t (* FG_anon_50)(FG_Backend *, double);
 enum FG_Cursor {
   FG_Cursor_NONE = 0,
   FG_Cursor_RESIZEWE = 7,
@@ -453,20 +451,26 @@ enum FG_Cursor {
   FG_Cursor_HAND = 5,
   FG_Cursor_CROSS = 3
 };
-typedef int32_t (* FG_anon_45)(FG_Backend *, FG_Window *, FG_Cursor);
-typedef FG_Shader * (* FG_anon_46)(FG_Backend *, const char*, const char*, const char*, const char*, const char*, const char*, FG_ShaderParameter *, uint32_t);
-typedef int32_t (* FG_anon_47)(FG_Backend *, FG_Window *, FG_Asset *, float *, float, FG_BlendState *);
-enum FG_BreakStyle {
-  FG_BreakStyle_NONE = 0,
-  FG_BreakStyle_CHARACTER = 2,
-  FG_BreakStyle_WORD = 1
+typedef int32_t (* FG_anon_51)(FG_Backend *, FG_Window *, FG_Cursor);
+typedef struct FG_Display__ FG_Display;
+struct FG_Display__ {
+  FG_Veci size;
+  FG_Veci offset;
+  FG_Vec dpi;
+  float scale;
+  void * handle;
+  bool primary;
+};
+typedef int32_t (* FG_anon_52)(FG_Backend *, uint32_t, FG_Display *);
+typedef int32_t (* FG_anon_53)(FG_Backend *, void *, FG_Display *);
+typedef int32_t (* FG_anon_54)(FG_Backend *, FG_Window *, FG_Display *);
+typedef struct FG_MsgReceiver__ FG_MsgReceiver;
+struct FG_MsgReceiver__ {
+  void * * vftable;
 };
-typedef void * (* FG_anon_48)(FG_Backend *, FG_Font *, const char*, FG_Rect *, float, float, FG_BreakStyle, void *);
-typedef uint32_t (* FG_anon_49)(FG_Backend *, FG_Font *, void *, FG_Rect *, FG_Vec, FG_Vec *);
-typedef uint32_t (* FG_anon_50)(FG_Backend *, FG_Window *, FG_Clipboard, void *, uint32_t);
-typedef int32_t (* FG_anon_51)(FG_Backend *, FG_Window *, FG_Asset *, float *);
-typedef void * (* FG_anon_52)(FG_Backend *, FG_Window *, const char*, FG_Rect *, ...);
-typedef int32_t (* FG_anon_53)(FG_Backend *, FG_Window *, void *);
+typedef FG_Window * (* FG_anon_55)(FG_Backend *, FG_MsgReceiver *, FG_Window, FG_Vec3, FG_Vec3);
+typedef FG_Window * (* FG_anon_56)(FG_Backend *, FG_MsgReceiver *, void *, FG_Vec *, FG_Vec *, const char*, uint64_t);
+typedef int32_t (* FG_anon_57)(FG_Backend *, FG_Window *, FG_MsgReceiver *, void *, FG_Vec *, FG_Vec *, const char*, uint64_t);
 struct FG_Backend__ {
   FG_anon_6 destroy;
   FG_Feature features;
@@ -476,45 +480,50 @@ struct FG_Backend__ {
   uint64_t cursorblink;
   uint64_t tooltipdelay;
   FG_anon_7 draw;
-  FG_anon_20 createAsset;
-  FG_anon_21 clearClipboard;
-  FG_anon_22 getDisplayIndex;
-  FG_anon_23 pushClip;
-  FG_anon_24 processMessages;
-  FG_anon_23 dirtyRect;
-  FG_anon_25 createWindow;
-  FG_anon_26 createRegion;
-  FG_anon_27 putClipboard;
-  FG_anon_28 fontPos;
-  FG_anon_29 popLayer;
-  FG_anon_30 setSystemControl;
-  FG_anon_31 clear;
-  FG_anon_32 setRenderTarget;
-  FG_anon_33 getSyncObject;
-  FG_anon_34 getDisplayWindow;
-  FG_anon_35 createBuffer;
-  FG_anon_36 destroyAsset;
-  FG_anon_29 endDraw;
-  FG_anon_37 checkClipboard;
+  FG_anon_20 clear;
+  FG_anon_21 pushLayer;
+  FG_anon_22 popLayer;
+  FG_anon_23 invalidateLayer;
+  FG_anon_24 setRenderTarget;
+  FG_anon_25 pushClip;
+  FG_anon_22 popClip;
+  FG_anon_25 dirtyRect;
+  FG_anon_25 beginDraw;
+  FG_anon_22 endDraw;
+  FG_anon_26 createShader;
+  FG_anon_27 destroyShader;
+  FG_anon_28 createFont;
+  FG_anon_29 destroyFont;
+  FG_anon_30 fontLayout;
+  FG_anon_31 destroyLayout;
+  FG_anon_32 fontIndex;
+  FG_anon_33 fontPos;
+  FG_anon_34 prewarmFont;
+  FG_anon_35 setFontFallback;
+  FG_anon_36 createAsset;
+  FG_anon_37 createBuffer;
   FG_anon_38 createLayer;
-  FG_anon_39 getDisplay;
-  FG_anon_40 setWindow;
-  FG_anon_41 destroyLayout;
-  FG_anon_42 destroyShader;
-  FG_anon_43 destroyFont;
-  FG_anon_44 createFont;
-  FG_anon_29 popClip;
-  FG_anon_45 setCursor;
-  FG_anon_46 createShader;
-  FG_anon_47 pushLayer;
-  FG_anon_48 fontLayout;
-  FG_anon_49 fontIndex;
-  FG_anon_29 destroyWindow;
-  FG_anon_50 getClipboard;
-  FG_anon_51 getProjection;
-  FG_anon_52 createSystemControl;
-  FG_anon_53 destroySystemControl;
-  FG_anon_23 beginDraw;
+  FG_anon_39 destroyAsset;
+  FG_anon_40 getProjection;
+  FG_anon_41 putClipboard;
+  FG_anon_42 getClipboard;
+  FG_anon_43 checkClipboard;
+  FG_anon_44 clearClipboard;
+  FG_anon_45 createSystemControl;
+  FG_anon_46 setSystemControl;
+  FG_anon_47 destroySystemControl;
+  FG_anon_48 getSyncObject;
+  FG_anon_49 processMessages;
+  FG_anon_50 waitMessages;
+  FG_anon_49 wake;
+  FG_anon_51 setCursor;
+  FG_anon_52 getDisplayIndex;
+  FG_anon_53 getDisplay;
+  FG_anon_54 getDisplayWindow;
+  FG_anon_55 createRegion;
+  FG_anon_56 createWindow;
+  FG_anon_57 setWindow;
+  FG_anon_22 destroyWindow;
 };
 static int32_t FG_BeginDraw(FG_Backend * self, FG_Window * window, FG_Rect * area) { return (*self->beginDraw)(self, window, area); }
 static FG_Window * FG_CreateWindow(FG_Backend * self, FG_MsgReceiver * element, void * display, FG_Vec * pos, FG_Vec * dim, const char* caption, uint64_t flags) { return (*self->createWindow)(self, element, display, pos, dim, caption, flags); }
@@ -591,7 +600,7 @@ struct FG_Result__ {
 };;
 };
 typedef struct FG_Msg__ FG_Msg;
-typedef struct FG_anon_54__ FG_anon_54;
+typedef struct FG_anon_54__ FG_anon_58;
 struct FG_anon_54__ {
   float x;
   float y;
@@ -602,65 +611,65 @@ struct FG_anon_54__ {
   uint8_t flags;
   uint8_t modkeys;
 };
-typedef struct FG_anon_55__ FG_anon_55;
+typedef struct FG_anon_55__ FG_anon_59;
 struct FG_anon_55__ {
   float x;
   float y;
   float delta;
   float hdelta;
 };
-typedef struct FG_anon_56__ FG_anon_56;
+typedef struct FG_anon_56__ FG_anon_60;
 struct FG_anon_56__ {
   float x;
   float y;
   uint8_t all;
   uint8_t modkeys;
 };
-typedef struct FG_anon_57__ FG_anon_57;
+typedef struct FG_anon_57__ FG_anon_61;
 struct FG_anon_57__ {
   uint16_t index;
   uint16_t button;
   uint8_t modkeys;
 };
-typedef struct FG_anon_58__ FG_anon_58;
+typedef struct FG_anon_58__ FG_anon_62;
 struct FG_anon_58__ {
   float x;
   float y;
   uint8_t all;
   uint8_t modkeys;
 };
-typedef struct FG_anon_59__ FG_anon_59;
+typedef struct FG_anon_59__ FG_anon_63;
 struct FG_anon_59__ {
   uint16_t index;
   uint16_t button;
   uint8_t modkeys;
 };
-typedef struct FG_anon_60__ FG_anon_60;
+typedef struct FG_anon_60__ FG_anon_64;
 struct FG_anon_60__ {
   ;
 };
-typedef struct FG_anon_61__ FG_anon_61;
+typedef struct FG_anon_61__ FG_anon_65;
 struct FG_anon_61__ {
   uint8_t key;
   uint8_t modkeys;
   uint16_t scancode;
 };
-typedef struct FG_anon_62__ FG_anon_62;
+typedef struct FG_anon_62__ FG_anon_66;
 struct FG_anon_62__ {
   int32_t subkind;
 };
-typedef struct FG_anon_63__ FG_anon_63;
+typedef struct FG_anon_63__ FG_anon_67;
 struct FG_anon_63__ {
   int32_t unicode;
   uint8_t modkeys;
 };
-typedef struct FG_anon_64__ FG_anon_64;
+typedef struct FG_anon_64__ FG_anon_68;
 struct FG_anon_64__ {
   uint8_t key;
   uint8_t modkeys;
   uint16_t scancode;
 };
-typedef struct FG_anon_65__ FG_anon_65;
+typedef struct FG_anon_65__ FG_anon_69;
 struct FG_anon_65__ {
   float x;
   float y;
@@ -671,7 +680,7 @@ struct FG_anon_65__ {
   uint8_t flags;
   uint8_t modkeys;
 };
-typedef struct FG_anon_66__ FG_anon_66;
+typedef struct FG_anon_66__ FG_anon_70;
 struct FG_anon_66__ {
   float x;
   float y;
@@ -682,11 +691,11 @@ struct FG_anon_66__ {
   uint8_t flags;
   uint8_t modkeys;
 };
-typedef struct FG_anon_67__ FG_anon_67;
+typedef struct FG_anon_67__ FG_anon_71;
 struct FG_anon_67__ {
   uint32_t flags;
 };
-typedef struct FG_anon_68__ FG_anon_68;
+typedef struct FG_anon_68__ FG_anon_72;
 struct FG_anon_68__ {
   float x;
   float y;
@@ -694,7 +703,7 @@ struct FG_anon_68__ {
   uint8_t modkeys;
   uint8_t button;
 };
-typedef struct FG_anon_69__ FG_anon_69;
+typedef struct FG_anon_69__ FG_anon_73;
 struct FG_anon_69__ {
   float x;
   float y;
@@ -702,18 +711,18 @@ struct FG_anon_69__ {
   uint8_t modkeys;
   uint8_t button;
 };
-typedef struct FG_anon_70__ FG_anon_70;
+typedef struct FG_anon_70__ FG_anon_74;
 struct FG_anon_70__ {
   uint16_t index;
   float value;
   uint16_t axis;
   uint8_t modkeys;
 };
-typedef struct FG_anon_71__ FG_anon_71;
+typedef struct FG_anon_71__ FG_anon_75;
 struct FG_anon_71__ {
   ;
 };
-typedef struct FG_anon_72__ FG_anon_72;
+typedef struct FG_anon_72__ FG_anon_76;
 struct FG_anon_72__ {
   float x;
   float y;
@@ -721,31 +730,31 @@ struct FG_anon_72__ {
   uint8_t modkeys;
   uint8_t button;
 };
-typedef struct FG_anon_73__ FG_anon_73;
+typedef struct FG_anon_73__ FG_anon_77;
 struct FG_anon_73__ {
   uint16_t index;
   FG_Vec3 velocity;
   FG_Vec3 rotation;
 };
-typedef struct FG_anon_74__ FG_anon_74;
+typedef struct FG_anon_74__ FG_anon_78;
 struct FG_anon_74__ {
   FG_Rect area;
 };
-typedef struct FG_anon_75__ FG_anon_75;
+typedef struct FG_anon_75__ FG_anon_79;
 struct FG_anon_75__ {
   int32_t kind;
   void * target;
   uint32_t count;
 };
-typedef struct FG_anon_76__ FG_anon_76;
+typedef struct FG_anon_76__ FG_anon_80;
 struct FG_anon_76__ {
   FG_Rect rect;
 };
-typedef struct FG_anon_77__ FG_anon_77;
+typedef struct FG_anon_77__ FG_anon_81;
 struct FG_anon_77__ {
   ;
 };
-typedef struct FG_anon_78__ FG_anon_78;
+typedef struct FG_anon_78__ FG_anon_82;
 struct FG_anon_78__ {
   float x;
   float y;
@@ -755,31 +764,31 @@ struct FG_anon_78__ {
 struct FG_Msg__ {
   uint16_t kind;
   union {
-  FG_anon_54 touchMove;
-  FG_anon_55 mouseScroll;
-  FG_anon_56 mouseOn;
-  FG_anon_57 joyButtonUp;
-  FG_anon_58 mouseOff;
-  FG_anon_59 joyButtonDown;
-  FG_anon_60 getWindowFlags;
-  FG_anon_61 keyDown;
-  FG_anon_62 action;
-  FG_anon_63 keyChar;
-  FG_anon_64 keyUp;
-  FG_anon_65 touchEnd;
-  FG_anon_66 touchBegin;
-  FG_anon_67 setWindowFlags;
-  FG_anon_68 mouseUp;
-  FG_anon_69 mouseDblClick;
-  FG_anon_70 joyAxis;
-  FG_anon_71 lostFocus;
-  FG_anon_72 mouseDown;
-  FG_anon_73 joyOrientation;
-  FG_anon_74 draw;
-  FG_anon_75 drop;
-  FG_anon_76 setWindowRect;
-  FG_anon_77 gotFocus;
-  FG_anon_78 mouseMove;
+  FG_anon_58 touchMove;
+  FG_anon_59 mouseScroll;
+  FG_anon_60 mouseOn;
+  FG_anon_61 joyButtonUp;
+  FG_anon_62 mouseOff;
+  FG_anon_63 joyButtonDown;
+  FG_anon_64 getWindowFlags;
+  FG_anon_65 keyDown;
+  FG_anon_66 action;
+  FG_anon_67 keyChar;
+  FG_anon_68 keyUp;
+  FG_anon_69 touchEnd;
+  FG_anon_70 touchBegin;
+  FG_anon_71 setWindowFlags;
+  FG_anon_72 mouseUp;
+  FG_anon_73 mouseDblClick;
+  FG_anon_74 joyAxis;
+  FG_anon_75 lostFocus;
+  FG_anon_76 mouseDown;
+  FG_anon_77 joyOrientation;
+  FG_anon_78 draw;
+  FG_anon_79 drop;
+  FG_anon_80 setWindowRect;
+  FG_anon_81 gotFocus;
+  FG_anon_82 mouseMove;
 };;
 };
 typedef FG_Result (* FG_Behavior)(FG_MsgReceiver *, FG_Window *, void *, FG_Msg *);
@@ -1049,6 +1058,11 @@ struct FG_URect__ {
   FG_Rect rel;
 };
 static int32_t FG_ProcessMessages(FG_Backend * self) { return (*self->processMessages)(self); }
+static int32_t FG_WaitMessages(FG_Backend * self, double timeout) { return (*self->waitMessages)(self, timeout); }
+static int32_t FG_Wake(FG_Backend * self) { return (*self->wake)(self); }
+static int32_t FG_InvalidateLayer(FG_Backend * self, FG_Window * window, FG_Asset * layer, FG_Rect * area) { return (*self->invalidateLayer)(self, window, layer, area); }
+static int32_t FG_PrewarmFont(FG_Backend * self, FG_Font * font, const char* text, uint32_t first, uint32_t last) { return (*self->prewarmFont)(self, font, text, first, last); }
+static int32_t FG_SetFontFallback(FG_Backend * self, FG_Font * font, FG_Font ** fallbacks, uint32_t count) { return (*self->setFontFallback)(self, font, fallbacks, count); }
 static FG_Asset * FG_CreateAsset(FG_Backend * self, const char* data, uint32_t count, FG_Format format, int32_t flags) { return (*self->createAsset)(self, data, count, format, flags); }
 static int32_t FG_DestroyLayout(FG_Backend * self, void * layout) { return (*self->destroyLayout)(self, layout); }
 static uint32_t FG_GetClipboard(FG_Backend * self, FG_Window * window, FG_Clipboard kind, void * target, uint32_t count) { return (*self->getClipboard)(self, window, kind, target, count); }